@@ -104,7 +104,11 @@ SOURCES += main.cpp \
     constantexpressionevaluator.cpp \
     genericstructvaluetype.cpp \
     structvaluetype.cpp \
-    nullvaluetype.cpp
+    nullvaluetype.cpp \
+    fortoboundsanalyzer.cpp \
+    fieldlayoutoptimizer.cpp \
+    soaelementvaluetype.cpp \
+    arraydimensionanalyzer.cpp
 
 HEADERS += \
     lexer.h \
@@ -161,4 +165,8 @@ HEADERS += \
     constantexpressionevaluator.h \
     structvaluetype.h \
     genericstructvaluetype.h \
-    nullvaluetype.h
+    nullvaluetype.h \
+    fortoboundsanalyzer.h \
+    fieldlayoutoptimizer.h \
+    soaelementvaluetype.h \
+    arraydimensionanalyzer.h
@@ -521,7 +521,10 @@ class KeywordFunctionCall : public Node {
 			Last,
 			Before,
 			After,
-			ArraySize
+			ArraySize,
+			ConvertToInteger,
+			ConvertToType,
+			SortType
 		};
 
 		KeywordFunctionCall(KeywordFunction type, const CodePoint &cp) : Node (cp), mKeyword(type), mParameters(0) {}
@@ -0,0 +1,105 @@
+#include "arraydimensionanalyzer.h"
+#include "scope.h"
+#include "variablesymbol.h"
+#include "valuetype.h"
+#include <limits>
+
+ArrayDimensionAnalyzer::ArrayDimensionAnalyzer() :
+	mScope(0) {
+}
+
+void ArrayDimensionAnalyzer::analyze(ast::Node *block, Scope *scope) {
+	mScope = scope;
+	mConstEval.setScope(scope);
+	block->accept(this);
+}
+
+void ArrayDimensionAnalyzer::addNonConstant(VariableSymbol *var) {
+	mNonConstant.insert(var);
+}
+
+void ArrayDimensionAnalyzer::apply() const {
+	for (QMap<VariableSymbol*, QList<int> >::ConstIterator i = mDimensions.begin(); i != mDimensions.end(); ++i) {
+		if (mNonConstant.contains(i.key())) continue;
+		i.key()->setConstantDimensions(i.value());
+	}
+}
+
+bool ArrayDimensionAnalyzer::actBefore(ast::ArrayInitialization *n) {
+	VariableSymbol *var = findVariable(n->identifier());
+	if (!var || !var->valueType()->isArray()) return false;
+
+	QList<int> dims = constantDimensions(n->dimensions());
+	if (dims.isEmpty()) {
+		mNonConstant.insert(var);
+		return false;
+	}
+
+	// Every Dim and Redim of the array has to use the same sizes
+	QMap<VariableSymbol*, QList<int> >::ConstIterator i = mDimensions.find(var);
+	if (i != mDimensions.end() && i.value() != dims) {
+		mNonConstant.insert(var);
+	}
+	mDimensions.insert(var, dims);
+	return false;
+}
+
+bool ArrayDimensionAnalyzer::actBefore(ast::Expression *n) {
+	if (n->associativity() != ast::Expression::RightToLeft) return false;
+
+	// a = b = c writes to every operand except the last one
+	ast::Node *target = n->firstOperand();
+	for (ast::ExpressionNode *op : n->operations()) {
+		if (op->op() != ast::ExpressionNode::opAssign) break;
+		VariableSymbol *var = findVariable(target);
+		if (var) mNonConstant.insert(var);
+		target = op->operand();
+	}
+	return false;
+}
+
+bool ArrayDimensionAnalyzer::actBefore(ast::VariableDefinition *n) {
+	VariableSymbol *var = findVariable(n->identifier());
+	if (var) mNonConstant.insert(var);
+	return false;
+}
+
+VariableSymbol *ArrayDimensionAnalyzer::findVariable(ast::Node *n) const {
+	Symbol *sym;
+	switch (n->type()) {
+		case ast::Node::ntIdentifier:
+			sym = mScope->find(n->cast<ast::Identifier>()->name()); break;
+		case ast::Node::ntVariable:
+			sym = mScope->find(n->cast<ast::Variable>()->identifier()->name()); break;
+		default:
+			return 0;
+	}
+	if (sym && sym->type() == Symbol::stVariable) return static_cast<VariableSymbol*>(sym);
+	return 0;
+}
+
+// Returns an empty list, if a size isn't a positive integer constant or the array would be too large.
+QList<int> ArrayDimensionAnalyzer::constantDimensions(ast::Node *dimensions) {
+	QList<ast::Node*> nodes;
+	if (dimensions->type() == ast::Node::ntList) {
+		for (ast::ChildNodeIterator i = dimensions->childNodesBegin(); i != dimensions->childNodesEnd(); i++) {
+			nodes.append(*i);
+		}
+	}
+	else {
+		nodes.append(dimensions);
+	}
+
+	QList<int> dims;
+	qint64 elements = 1;
+	for (ast::Node *node : nodes) {
+		ConstantValue size = mConstEval.evaluate(node);
+		if (!(size.type() == ConstantValue::Integer || size.type() == ConstantValue::Short || size.type() == ConstantValue::Byte)) return QList<int>();
+		int s = size.toInt();
+		if (s <= 0) return QList<int>();
+		elements *= s;
+		if (elements > std::numeric_limits<int>::max()) return QList<int>();
+		dims.append(s);
+	}
+	return dims;
+}
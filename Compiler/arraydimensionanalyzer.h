@@ -0,0 +1,50 @@
+#ifndef ARRAYDIMENSIONANALYZER_H
+#define ARRAYDIMENSIONANALYZER_H
+#include "astvisitor.h"
+#include "constantexpressionevaluator.h"
+#include <QMap>
+#include <QSet>
+#include <QList>
+
+class Scope;
+class VariableSymbol;
+
+/**
+ * @brief The ArrayDimensionAnalyzer class finds the array variables, which are always dimensioned
+ * with the same constant sizes and never assigned any other way. The index calculation of those arrays
+ * can use the sizes known at compile time instead of loading them from the array header.
+ */
+class ArrayDimensionAnalyzer : protected ast::Visitor {
+	public:
+		ArrayDimensionAnalyzer();
+
+		/**
+		 * @brief analyze Analyzes a block of code. Every block using the arrays has to be analyzed before apply() is called.
+		 * @param scope The scope of the block
+		 */
+		void analyze(ast::Node *block, Scope *scope);
+
+		/**
+		 * @brief addNonConstant Marks the variable to have unknown dimensions, e.g. because it's a function parameter.
+		 */
+		void addNonConstant(VariableSymbol *var);
+
+		/**
+		 * @brief apply Sets the constant dimensions of the analyzed array variables to their VariableSymbols.
+		 */
+		void apply() const;
+	private:
+		bool actBefore(ast::ArrayInitialization *n);
+		bool actBefore(ast::Expression *n);
+		bool actBefore(ast::VariableDefinition *n);
+
+		VariableSymbol *findVariable(ast::Node *n) const;
+		QList<int> constantDimensions(ast::Node *dimensions);
+
+		Scope *mScope;
+		ConstantExpressionEvaluator mConstEval;
+		QMap<VariableSymbol*, QList<int> > mDimensions;
+		QSet<VariableSymbol*> mNonConstant;
+};
+
+#endif // ARRAYDIMENSIONANALYZER_H
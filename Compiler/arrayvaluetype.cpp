@@ -4,6 +4,8 @@
 #include "runtime.h"
 #include "abstractsyntaxtree.h"
 #include "intvaluetype.h"
+#include "structvaluetype.h"
+#include "soaelementvaluetype.h"
 
 ArrayValueType::ArrayValueType(ValueType *baseType, llvm::Type *llvmType, int dimensions):
 	ValueType(baseType->runtime(), llvmType),
@@ -58,7 +60,7 @@ void ArrayValueType::generateDestructor(Builder *builder, const Value &value) {
 
 Value ArrayValueType::generateLoad(Builder *builder, const Value &var) const {
 	assert(var.isReference());
-	llvm::Value *v = builder->irBuilder().CreateLoad(var.value());
+	llvm::Value *v = builder->load(var.value());
 	refArray(builder, v);
 	return Value(var.valueType(), v, false);
 }
@@ -71,7 +73,7 @@ Value ArrayValueType::dimensionSize(Builder *builder, const Value &array, const
 	llvm::Value *gepParams[2];
 	gepParams[0] = irBuilder.getInt32(0);
 	gepParams[1] = builder->llvmValue(builder->toInt(dimNum));
-	llvm::Value *size = irBuilder.CreateLoad(irBuilder.CreateGEP(sizes, gepParams));
+	llvm::Value *size = loadHeaderField(builder, irBuilder.CreateGEP(sizes, gepParams));
 	if (size->getType() != irBuilder.getInt32Ty()) {
 		size = irBuilder.CreateTrunc(size, irBuilder.getInt32Ty());
 	}
@@ -124,16 +126,25 @@ Value ArrayValueType::constructArray(Builder *builder, const QList<Value> &dims)
 	return Value(this, builder->irBuilder().CreateCall(mConstructFunction, params));
 }
 
-Value ArrayValueType::arraySubscript(Builder *builder, const Value &array, const QList<Value> &dims) {
+Value ArrayValueType::arraySubscript(Builder *builder, const Value &array, const QList<Value> &dims, const QList<int> &constantSizes) {
 	assert(array.valueType() == this);
 	assert(mDimensions == dims.size());
+	assert(constantSizes.isEmpty() || constantSizes.size() == mDimensions);
 	llvm::Value *arr = builder->llvmValue(array);
 	llvm::IRBuilder<> &irBuilder = builder->irBuilder();
 	llvm::Value *arrayDataHeader = irBuilder.CreateStructGEP(arr, 0);
 	llvm::Value *genericHeader = irBuilder.CreateStructGEP(arrayDataHeader, 0);
-	llvm::Value *offset = irBuilder.CreateStructGEP(genericHeader, 4);
 	llvm::Value *mults = irBuilder.CreateStructGEP(arrayDataHeader, 2);
 
+	// The multipliers of constant sized arrays are known at compile time
+	QList<qint64> constantMults;
+	if (!constantSizes.isEmpty()) {
+		qint64 mult = 1;
+		for (int dim = mDimensions - 1; dim >= 0; dim--) {
+			constantMults.prepend(mult);
+			mult *= constantSizes.at(dim);
+		}
+	}
 
 	int i = 0;
 	llvm::Value *sum = 0;
@@ -141,8 +152,14 @@ Value ArrayValueType::arraySubscript(Builder *builder, const Value &array, const
 	gepParams[0] = irBuilder.getInt32(0);
 	for (const Value &val : dims) {
 		llvm::Value *v = builder->intPtrTypeValue(val);
-		gepParams[1] = irBuilder.getInt32(i);
-		llvm::Value *mult = irBuilder.CreateLoad(irBuilder.CreateGEP(mults, gepParams));
+		llvm::Value *mult;
+		if (constantMults.isEmpty()) {
+			gepParams[1] = irBuilder.getInt32(i);
+			mult = loadHeaderField(builder, irBuilder.CreateGEP(mults, gepParams));
+		}
+		else {
+			mult = llvm::ConstantInt::get(v->getType(), constantMults.at(i));
+		}
 		llvm::Value *r = irBuilder.CreateMul(v, mult);
 		if (sum) {
 			sum = irBuilder.CreateAdd(sum, r);
@@ -152,15 +169,87 @@ Value ArrayValueType::arraySubscript(Builder *builder, const Value &array, const
 		i++;
 	}
 
-	llvm::Value *arrData = irBuilder.CreateBitCast(arr, irBuilder.getInt8PtrTy());
-	arrData = irBuilder.CreateGEP(arrData, irBuilder.CreateLoad(offset));
+	llvm::Value *arrData = dataPointer(builder, arr);
+
+	if (isSoA()) {
+		llvm::Value *elementCount;
+		if (constantSizes.isEmpty()) {
+			elementCount = loadHeaderField(builder, irBuilder.CreateStructGEP(genericHeader, 0));
+		}
+		else {
+			elementCount = llvm::ConstantInt::get(sum->getType(), constantMults.first() * constantSizes.first());
+		}
+		arrData = irBuilder.CreateBitCast(arrData, irBuilder.getInt8PtrTy());
+		return static_cast<StructValueType*>(mBaseValueType)->soaElementValueType()->element(builder, arrData, elementCount, sum);
+	}
 
-	arrData = irBuilder.CreateBitCast(arrData, mBaseValueType->llvmType()->getPointerTo());
 	arrData = irBuilder.CreateGEP(arrData, sum);
+	if (!mBaseValueType->isStruct()) {
+		builder->setTBAATag(arrData, builder->arrayDataTBAA(mBaseValueType));
+	}
 	return Value(mBaseValueType, arrData, true);
 
 }
 
+bool ArrayValueType::isSoA() const {
+	return mBaseValueType->isStruct() && static_cast<StructValueType*>(mBaseValueType)->hasSoAArrays();
+}
+
+void ArrayValueType::checkIndex(Builder *builder, const Value &array, int dim, const Value &index, const QList<int> &constantSizes) {
+	assert(dim >= 0 && dim < mDimensions);
+	llvm::IRBuilder<> &irBuilder = builder->irBuilder();
+	llvm::Value *idx = builder->intPtrTypeValue(index);
+	llvm::Value *size;
+	if (constantSizes.isEmpty()) {
+		size = dimensionSizeIntPtr(builder, builder->llvmValue(array), dim);
+	}
+	else {
+		size = llvm::ConstantInt::get(idx->getType(), constantSizes.at(dim));
+	}
+
+	//Negative indices wrap to huge unsigned values, so one comparison is enough.
+	llvm::Value *outOfBounds = irBuilder.CreateICmpUGE(idx, size);
+	generateBoundsFailureBranch(builder, outOfBounds, dim, idx, size);
+}
+
+llvm::Value *ArrayValueType::dimensionSizeIntPtr(Builder *builder, llvm::Value *arr, int dim) {
+	llvm::IRBuilder<> &irBuilder = builder->irBuilder();
+	llvm::Value *arrayDataHeader = irBuilder.CreateStructGEP(arr, 0);
+	llvm::Value *sizes = irBuilder.CreateStructGEP(arrayDataHeader, 1);
+	llvm::Value *gepParams[2];
+	gepParams[0] = irBuilder.getInt32(0);
+	gepParams[1] = irBuilder.getInt32(dim);
+	return loadHeaderField(builder, irBuilder.CreateGEP(sizes, gepParams));
+}
+
+void ArrayValueType::generateBoundsFailureBranch(Builder *builder, llvm::Value *outOfBounds, int dim, llvm::Value *index, llvm::Value *size) {
+	llvm::IRBuilder<> &irBuilder = builder->irBuilder();
+	llvm::Function *func = irBuilder.GetInsertBlock()->getParent();
+	llvm::BasicBlock *failBB = llvm::BasicBlock::Create(builder->context(), "boundsCheckFailBB", func);
+	llvm::BasicBlock *okBB = llvm::BasicBlock::Create(builder->context(), "boundsCheckOkBB", func);
+
+	//The failure path is cold
+	llvm::MDBuilder mdBuilder(builder->context());
+	irBuilder.CreateCondBr(outOfBounds, failBB, okBB, mdBuilder.createBranchWeights(1, 1 << 20));
+
+	irBuilder.SetInsertPoint(failBB);
+	llvm::CallInst *call = irBuilder.CreateCall3(
+				mRuntime->genericArrayValueType()->indexOutOfBoundsFunction(),
+				llvm::ConstantInt::get(size->getType(), dim),
+				index,
+				size);
+	call->setDoesNotReturn();
+	irBuilder.CreateUnreachable();
+
+	irBuilder.SetInsertPoint(okBB);
+}
+
+llvm::Value *ArrayValueType::loadHeaderField(Builder *builder, llvm::Value *fieldPtr) const {
+	llvm::LoadInst *load = builder->irBuilder().CreateLoad(fieldPtr);
+	load->setMetadata(llvm::LLVMContext::MD_tbaa, builder->arrayHeaderTBAA());
+	return load;
+}
+
 void ArrayValueType::refArray(Builder *builder, llvm::Value *array) const {
 	builder->irBuilder().CreateCall(
 				mRuntime->genericArrayValueType()->refFunction(),
@@ -174,14 +263,13 @@ void ArrayValueType::destructArray(Builder *builder, llvm::Value *array) {
 }
 
 llvm::Value *ArrayValueType::dataArray(Builder *builder, const Value &array) {
-	llvm::Value *arr = builder->llvmValue(array);
-	llvm::IRBuilder<> &irBuilder = builder->irBuilder();
-	llvm::Value *arrayDataHeader = irBuilder.CreateStructGEP(arr, 0);
-	llvm::Value *genericHeader = irBuilder.CreateStructGEP(arrayDataHeader, 0);
-	llvm::Value *offset = irBuilder.CreateLoad(irBuilder.CreateStructGEP(genericHeader, 4));
-	llvm::Value *arrData = irBuilder.CreateBitCast(arr, irBuilder.getInt8PtrTy());
-	arrData = irBuilder.CreateGEP(arrData, offset);
-	return irBuilder.CreateBitCast(arrData, mBaseValueType->llvmType()->getPointerTo());
+	return dataPointer(builder, builder->llvmValue(array));
+}
+
+// The runtime places the data right after the sizes and the multipliers (mOffset is the size of
+// the complete header), which is the offset of the data element of the array type.
+llvm::Value *ArrayValueType::dataPointer(Builder *builder, llvm::Value *arr) const {
+	return builder->irBuilder().CreateStructGEP(arr, 1);
 }
 
 llvm::Value *ArrayValueType::totalSize(Builder *builder, const Value &array) {
@@ -189,6 +277,6 @@ llvm::Value *ArrayValueType::totalSize(Builder *builder, const Value &array) {
 	llvm::IRBuilder<> &irBuilder = builder->irBuilder();
 	llvm::Value *arrayDataHeader = irBuilder.CreateStructGEP(arr, 0);
 	llvm::Value *genericHeader = irBuilder.CreateStructGEP(arrayDataHeader, 0);
-	llvm::Value *fullSize = irBuilder.CreateLoad(irBuilder.CreateStructGEP(genericHeader, 0));
+	llvm::Value *fullSize = loadHeaderField(builder, irBuilder.CreateStructGEP(genericHeader, 0));
 	return fullSize;
 }
@@ -29,7 +29,15 @@ class ArrayValueType : public ValueType {
 
 		void assignArray(Builder *builder, llvm::Value *var, llvm::Value *array);
 		Value constructArray(Builder *builder, const QList<Value> &dims);
-		Value arraySubscript(Builder *builder, const Value &array, const QList<Value> &dims);
+		/**
+		 * @brief arraySubscript Returns a reference to the element.
+		 * @param constantSizes The sizes of the dimensions, if they are known at compile time. Otherwise empty.
+		 */
+		Value arraySubscript(Builder *builder, const Value &array, const QList<Value> &dims, const QList<int> &constantSizes = QList<int>());
+
+		/** Generates a check that index is inside the dimension dim. An index out of bounds calls CB_ArrayIndexOutOfBounds. */
+		void checkIndex(Builder *builder, const Value &array, int dim, const Value &index, const QList<int> &constantSizes = QList<int>());
+
 		void refArray(Builder *builder, llvm::Value *array) const;
 		void destructArray(Builder *builder, llvm::Value *array);
 
@@ -38,7 +46,17 @@ class ArrayValueType : public ValueType {
 
 		int dimensions() const { return mDimensions; }
 		ValueType *baseType() const { return mBaseValueType; }
+		/**
+		 * @brief isSoA Returns true, if the array is an array of structs, which stores every field in its own column.
+		 * Subscripts of such arrays return SoAElementValueType values instead of references to the base type.
+		 */
+		bool isSoA() const;
 	private:
+		llvm::Value *dimensionSizeIntPtr(Builder *builder, llvm::Value *arr, int dim);
+		llvm::Value *loadHeaderField(Builder *builder, llvm::Value *fieldPtr) const;
+		llvm::Value *dataPointer(Builder *builder, llvm::Value *arr) const;
+		void generateBoundsFailureBranch(Builder *builder, llvm::Value *outOfBounds, int dim, llvm::Value *index, llvm::Value *size);
+
 		ValueType *mBaseValueType;
 		llvm::Function *mConstructFunction;
 		int mDimensions;
@@ -46,6 +46,13 @@ void Builder::setInsertPoint(llvm::BasicBlock *basicBlock) {
 	mIRBuilder.SetInsertPoint(basicBlock);
 }
 
+void Builder::setFastMath(bool enabled) {
+	// Unsafe algebra implies no NaNs, no infinities, no signed zeros and allows reciprocals.
+	llvm::FastMathFlags flags;
+	if (enabled) flags.setUnsafeAlgebra();
+	mIRBuilder.SetFastMathFlags(flags);
+}
+
 Value Builder::toInt(const Value &v) {
 	if (v.valueType()->basicType() == ValueType::Integer) return v;
 	if (v.isConstant()) {
@@ -220,11 +227,24 @@ llvm::Value *Builder::llvmValue(const Value &v) {
 
 	assert(v.value());
 	if (v.isReference()) {
-		return mIRBuilder.CreateLoad(v.value(), false);
+		return load(v.value());
 	}
 	return v.value();
 }
 
+llvm::Value *Builder::llvmArgument(const Value &v) {
+	if (!v.valueType()->isStruct()) return llvmValue(v);
+	if (v.isReference()) return v.value();
+
+	// The callee gets its own copy of the struct, so a temporary is enough. It's allocated
+	// in the entry block so calls inside loops don't grow the stack.
+	llvm::BasicBlock &entryBlock = mIRBuilder.GetInsertBlock()->getParent()->getEntryBlock();
+	llvm::IRBuilder<> entryBuilder(&entryBlock, entryBlock.begin());
+	llvm::Value *temp = entryBuilder.CreateAlloca(v.valueType()->llvmType());
+	store(temp, llvmValue(v));
+	return temp;
+}
+
 llvm::Value *Builder::llvmValue(int i) {
 	return mIRBuilder.getInt32(i);
 }
@@ -318,10 +338,12 @@ Value Builder::call(FunctionValueType *funcType, llvm::Value *func, QList<Value>
 		//string destruction hack
 		i->toLLVMValue(this);
 		pi++;
-		args.push_back(llvmValue(*i));
+		args.push_back(llvmArgument(*i));
 	}
 
-	Value ret = Value(funcType->returnType(), mIRBuilder.CreateCall(func, args), false);
+	llvm::CallInst *call = mIRBuilder.CreateCall(func, args);
+	funcType->setParameterAttributes(call);
+	Value ret = Value(funcType->returnType(), call, false);
 	for (QList<Value>::ConstIterator i = params.begin(); i != params.end(); ++i) {
 		destruct(*i);
 	}
@@ -366,13 +388,13 @@ void Builder::store(const Value &ref, const Value &value) {
 		arrayValueType->assignArray(this, ref.value(), llvmValue(value));
 	}
 	else {
-		mIRBuilder.CreateStore(llvmValue(value), ref.value());
+		store(ref.value(), llvmValue(value));
 	}
 }
 
 void Builder::store(llvm::Value *ptr, llvm::Value *val) {
 	assert(ptr->getType() == val->getType()->getPointerTo());
-	mIRBuilder.CreateStore(val, ptr);
+	decorateMemoryAccess(mIRBuilder.CreateStore(val, ptr), ptr);
 }
 
 void Builder::store(VariableSymbol *var, const Value &v) {
@@ -412,6 +434,12 @@ Value Builder::load(const Value &var) {
 	return var.valueType()->generateLoad(this, var);
 }
 
+llvm::Value *Builder::load(llvm::Value *ptr) {
+	llvm::LoadInst *inst = mIRBuilder.CreateLoad(ptr, false);
+	decorateMemoryAccess(inst, ptr);
+	return inst;
+}
+
 /*Value Builder::load(const Value &ref, const Value &index) {
 	return Value(ref->valueType(), mIRBuilder.CreateLoad(arrayElementPointer(ref, index)), false);
 }
@@ -533,6 +561,9 @@ Value Builder::typePointerFieldReference(Value typePtrVar, const QString &fieldN
 	const TypeField &field = type->field(fieldName);
 	int fieldIndex = type->fieldIndex(fieldName);
 	llvm::Value *fieldPtr = mIRBuilder.CreateStructGEP(llvmValue(typePtrVar), fieldIndex);
+	if (!field.valueType()->isStruct()) {
+		setTBAATag(fieldPtr, typeFieldTBAA(type->name(), fieldName));
+	}
 	return Value(field.valueType(), fieldPtr, true);
 }
 
@@ -542,29 +573,80 @@ Value Builder::newTypeMember(TypeSymbol *type) {
 }
 
 Value Builder::firstTypeMember(TypeSymbol *type) {
-	llvm::Value *typePtr = mIRBuilder.CreateCall(mRuntime->typeValueType()->firstFunction(), type->globalTypeVariable());
+	llvm::Value *typePtr = loadTypeListLink(type->globalTypeVariable(), 0);
 	return Value(type->typePointerValueType(), bitcast(type->typePointerValueType()->llvmType(), typePtr), false);
 }
 
 Value Builder::lastTypeMember(TypeSymbol *type) {
-	llvm::Value *typePtr = mIRBuilder.CreateCall(mRuntime->typeValueType()->lastFunction(), type->globalTypeVariable());
+	llvm::Value *typePtr = loadTypeListLink(type->globalTypeVariable(), 1);
 	return Value(type->typePointerValueType(), bitcast(type->typePointerValueType()->llvmType(), typePtr), false);
 }
 
 Value Builder::afterTypeMember(const Value &ptr) {
 	assert(ptr.valueType()->isTypePointer());
-	llvm::Value *param = bitcast(mRuntime->typePointerCommonValueType()->llvmType(), llvmValue(ptr));
-	llvm::Value *typePtr = mIRBuilder.CreateCall(mRuntime->typeValueType()->afterFunction(), param);
+	llvm::Value *typePtr = typeMemberLink(ptr, 0, mRuntime->typeValueType()->afterFunction());
 	return Value(ptr.valueType(), bitcast(ptr.valueType()->llvmType(), typePtr), false);
 }
 
 Value Builder::beforeTypeMember(const Value &ptr) {
 	assert(ptr.valueType()->isTypePointer());
-	llvm::Value *param = bitcast(mRuntime->typePointerCommonValueType()->llvmType(), llvmValue(ptr));
-	llvm::Value *typePtr = mIRBuilder.CreateCall(mRuntime->typeValueType()->beforeFunction(), param);
+	llvm::Value *typePtr = typeMemberLink(ptr, 1, mRuntime->typeValueType()->beforeFunction());
 	return Value(ptr.valueType(), bitcast(ptr.valueType()->llvmType(), typePtr), false);
 }
 
+// Loads CB_Type::mFirst (0), CB_Type::mLast (1), CB_TypeMember::mAfter (0) or CB_TypeMember::mBefore (1)
+llvm::Value *Builder::loadTypeListLink(llvm::Value *ptr, unsigned linkIndex) {
+	llvm::LoadInst *load = mIRBuilder.CreateLoad(mIRBuilder.CreateStructGEP(ptr, linkIndex));
+	load->setMetadata(llvm::LLVMContext::MD_tbaa, typeListTBAA());
+	return load;
+}
+
+// Reads the link of the type member directly. The runtime function is called only
+// on the cold path, when the member is null, to report the error.
+llvm::Value *Builder::typeMemberLink(const Value &ptr, unsigned linkIndex, llvm::Function *nullHandler) {
+	llvm::Value *member = llvmValue(ptr);
+	llvm::Function *func = mIRBuilder.GetInsertBlock()->getParent();
+	llvm::BasicBlock *nullBB = llvm::BasicBlock::Create(context(), "typeMemberNullBB", func);
+	llvm::BasicBlock *notNullBB = llvm::BasicBlock::Create(context(), "typeMemberNotNullBB", func);
+	llvm::BasicBlock *endBB = llvm::BasicBlock::Create(context(), "typeMemberLinkBB", func);
+
+	llvm::MDBuilder mdBuilder(context());
+	mIRBuilder.CreateCondBr(mIRBuilder.CreateIsNull(member), nullBB, notNullBB, mdBuilder.createBranchWeights(1, 1 << 20));
+
+	mIRBuilder.SetInsertPoint(nullBB);
+	llvm::Value *nullResult = mIRBuilder.CreateCall(nullHandler, llvm::Constant::getNullValue(nullHandler->getFunctionType()->getParamType(0)));
+	mIRBuilder.CreateBr(endBB);
+
+	mIRBuilder.SetInsertPoint(notNullBB);
+	llvm::Value *link = loadTypeListLink(member, linkIndex);
+	mIRBuilder.CreateBr(endBB);
+
+	mIRBuilder.SetInsertPoint(endBB);
+	llvm::PHINode *phi = mIRBuilder.CreatePHI(link->getType(), 2);
+	phi->addIncoming(nullResult, nullBB);
+	phi->addIncoming(link, notNullBB);
+	return phi;
+}
+
+Value Builder::typeMemberHandle(const Value &ptr) {
+	assert(ptr.valueType()->isTypePointer());
+	llvm::Value *param = bitcast(mRuntime->typePointerCommonValueType()->llvmType(), llvmValue(ptr));
+	llvm::Value *handle = mIRBuilder.CreateCall(mRuntime->typeValueType()->handleFunction(), param);
+	return Value(mRuntime->intValueType(), handle, false);
+}
+
+Value Builder::typeMemberFromHandle(TypeSymbol *type, const Value &handle) {
+	llvm::Value *typePtr = mIRBuilder.CreateCall2(mRuntime->typeValueType()->fromHandleFunction(), type->globalTypeVariable(), llvmValue(handle));
+	return Value(type->typePointerValueType(), bitcast(type->typePointerValueType()->llvmType(), typePtr), false);
+}
+
+void Builder::sortTypeMembers(TypeSymbol *type, const QString &fieldName, int keyType, const Value &descending) {
+	const llvm::StructLayout *layout = mRuntime->dataLayout().getStructLayout(type->llvmMemberType());
+	llvm::Value *fieldOffset = llvm::ConstantInt::get(llvm::Type::getInt32Ty(context()), layout->getElementOffset(type->fieldIndex(fieldName)));
+	llvm::Value *key = llvm::ConstantInt::get(llvm::Type::getInt32Ty(context()), keyType);
+	mIRBuilder.CreateCall4(mRuntime->typeValueType()->sortFunction(), type->globalTypeVariable(), fieldOffset, key, llvmValue(toInt(descending)));
+}
+
 Value Builder::typePointerNotNull(const Value &ptr) {
 	assert(ptr.valueType()->isTypePointer());
 	return Value(mRuntime->booleanValueType(), mIRBuilder.CreateIsNotNull(llvmValue(ptr)), false);
@@ -1740,4 +1822,56 @@ void Builder::popInsertPoint() {
 	mIRBuilder.restoreIP(insertPoint);
 }
 
+void Builder::setTBAATag(llvm::Value *ptr, llvm::MDNode *tag) {
+	mTBAATags[ptr] = tag;
+}
+
+// Every tag is a leaf of the TBAA tree, so accesses with different tags never alias. Accesses without
+// a tag (runtime functions, memcpy, aggregate accesses) may alias anything.
+llvm::MDNode *Builder::arrayHeaderTBAA() {
+	return tbaaNode("array header", QString());
+}
+
+llvm::MDNode *Builder::arrayDataTBAA(ValueType *elementType) {
+	return tbaaNode("array data " + elementType->name(), "array data");
+}
+
+llvm::MDNode *Builder::typeFieldTBAA(const QString &typeName, const QString &fieldName) {
+	return tbaaNode("type field " + typeName + "." + fieldName, "type field");
+}
+
+llvm::MDNode *Builder::structFieldTBAA(const QString &structName, const QString &fieldName) {
+	return tbaaNode("struct field " + structName + "." + fieldName, "struct field");
+}
+
+llvm::MDNode *Builder::globalVariableTBAA(const QString &name) {
+	return tbaaNode("global " + name, "global");
+}
+
+llvm::MDNode *Builder::typeListTBAA() {
+	return tbaaNode("type list", QString());
+}
+
+llvm::MDNode *Builder::tbaaNode(const QString &name, const QString &parentName) {
+	QMap<QString, llvm::MDNode*>::ConstIterator i = mTBAANodes.find(name);
+	if (i != mTBAANodes.end()) return i.value();
+
+	llvm::MDBuilder mdBuilder(context());
+	llvm::MDNode *node;
+	if (name == "CBCompiler TBAA") {
+		node = mdBuilder.createTBAARoot(name.toStdString());
+	}
+	else {
+		llvm::MDNode *parent = tbaaNode(parentName.isEmpty() ? QString("CBCompiler TBAA") : parentName, QString());
+		node = mdBuilder.createTBAANode(name.toStdString(), parent);
+	}
+	mTBAANodes.insert(name, node);
+	return node;
+}
 
+void Builder::decorateMemoryAccess(llvm::Instruction *inst, llvm::Value *ptr) {
+	llvm::ValueMap<llvm::Value*, llvm::MDNode*>::const_iterator i = mTBAATags.find(ptr);
+	if (i != mTBAATags.end()) {
+		inst->setMetadata(llvm::LLVMContext::MD_tbaa, i->second);
+	}
+}
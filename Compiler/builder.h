@@ -5,6 +5,7 @@
 #include "function.h"
 #include <QList>
 #include <QStack>
+#include <QMap>
 
 #include "runtime.h"
 class VariableSymbol;
@@ -24,6 +25,11 @@ class Builder {
 		void setInsertPoint(llvm::BasicBlock *basicBlock);
 		llvm::IRBuilder<> & irBuilder() { return mIRBuilder; }
 
+		/**
+		 * @brief setFastMath Enables or disables the fast-math flags of the float operations generated after this call.
+		 */
+		void setFastMath(bool enabled);
+
 		Value toInt(const Value &v);
 		Value toFloat(const Value &v);
 		Value toString(const Value &v);
@@ -65,6 +71,16 @@ class Builder {
 		void store(VariableSymbol *typePtrVar, const QString &fieldName, const Value &v);
 		Value load(const VariableSymbol *var);
 		Value load(const Value &var);
+		/**
+		 * @brief Loads the value pointed by ptr. The load gets the TBAA tag of ptr set with setTBAATag.
+		 * @param ptr A pointer
+		 * @return Loaded value
+		 */
+		llvm::Value *load(llvm::Value *ptr);
+		/**
+		 * @brief llvmArgument Returns the value as a function call argument. Structs are passed as pointers.
+		 */
+		llvm::Value *llvmArgument(const Value &v);
 		/*Value load(const Value &ref, const Value &index);
 		Value load(const Value &ref, const QList<Value> &dims);*/
 		void destruct(VariableSymbol *var);
@@ -89,6 +105,19 @@ class Builder {
 		Value afterTypeMember(const Value &ptr);
 		Value beforeTypeMember(const Value &ptr);
 		Value typePointerNotNull(const Value &ptr);
+		/**
+		 * @brief typeMemberHandle Returns an integer handle of the type member. The handle can be converted back
+		 * with typeMemberFromHandle until the member is deleted.
+		 */
+		Value typeMemberHandle(const Value &ptr);
+		/**
+		 * @brief typeMemberFromHandle Returns the type member of the handle or null, if the handle is invalid.
+		 */
+		Value typeMemberFromHandle(TypeSymbol *type, const Value &handle);
+		/**
+		 * @brief sortTypeMembers Sorts the members of the type by the field. keyType is one of TypeValueType::SortKeyType.
+		 */
+		void sortTypeMembers(TypeSymbol *type, const QString &fieldName, int keyType, const Value &descending);
 
 		llvm::GlobalVariable *createGlobalVariable(ValueType *type, bool isConstant, llvm::GlobalValue::LinkageTypes linkage, llvm::Constant *initializer, const llvm::Twine &name = llvm::Twine());
 		llvm::GlobalVariable *createGlobalVariable(llvm::Type *type, bool isConstant, llvm::GlobalValue::LinkageTypes linkage, llvm::Constant *initializer, const llvm::Twine &name = llvm::Twine());
@@ -160,11 +189,38 @@ class Builder {
 
 		llvm::BasicBlock *currentBasicBlock() const;
 
+		/**
+		 * @brief setTBAATag sets the type-based alias analysis tag of the memory pointed by ptr.
+		 * Loads and stores through ptr made with Builder get the tag. Only scalar accesses should be tagged.
+		 * @param ptr A pointer returned by a GEP or a global variable
+		 * @param tag One of the TBAA tags created by Builder
+		 */
+		void setTBAATag(llvm::Value *ptr, llvm::MDNode *tag);
+
+		/**
+		 * @brief arrayHeaderTBAA TBAA tag for the array headers. The header doesn't alias the array data, so the reads
+		 * can be hoisted out of loops, which write to the array. The header is written by the runtime when the array
+		 * is constructed, so the memory isn't marked constant.
+		 */
+		llvm::MDNode *arrayHeaderTBAA();
+		llvm::MDNode *arrayDataTBAA(ValueType *elementType);
+		llvm::MDNode *typeFieldTBAA(const QString &typeName, const QString &fieldName);
+		llvm::MDNode *structFieldTBAA(const QString &structName, const QString &fieldName);
+		llvm::MDNode *globalVariableTBAA(const QString &name);
+		/**
+		 * @brief typeListTBAA TBAA tag for the links of the Type lists (CB_Type first/last and CB_TypeMember after/before).
+		 */
+		llvm::MDNode *typeListTBAA();
+
 
 		//Dont work. Dont use
 		void pushInsertPoint();
 		void popInsertPoint();
 	private:
+		llvm::MDNode *tbaaNode(const QString &name, const QString &parentName);
+		void decorateMemoryAccess(llvm::Instruction *inst, llvm::Value *ptr);
+		llvm::Value *loadTypeListLink(llvm::Value *ptr, unsigned linkIndex);
+		llvm::Value *typeMemberLink(const Value &ptr, unsigned linkIndex, llvm::Function *nullHandler);
 
 		llvm::IRBuilder<> mIRBuilder;
 		QStack<llvm::IRBuilder<>::InsertPoint> mInsertPointStack;
@@ -173,6 +229,10 @@ class Builder {
 
 		llvm::Function *mPowFF;
 		llvm::Function *mPowFI;
+
+		// A ValueMap drops the tag when the pointer is deleted, so a new value at the same address doesn't get it
+		llvm::ValueMap<llvm::Value*, llvm::MDNode*> mTBAATags;
+		QMap<QString, llvm::MDNode*> mTBAANodes;
 };
 
 #endif // BUILDER_H
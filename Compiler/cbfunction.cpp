@@ -25,6 +25,7 @@ CBFunction::~CBFunction() {
 void CBFunction::generateFunction(Runtime *runtime) {
 	mFunctionValueType = new FunctionValueType(mReturnValue->runtime(), this);
 	mFunction = llvm::Function::Create(llvm::cast<llvm::FunctionType>(mFunctionValueType->llvmType()), llvm::Function::PrivateLinkage, "CBF_user_" + mName.toStdString(), runtime->module());
+	mFunctionValueType->setParameterAttributes(mFunction);
 }
 
 
@@ -32,7 +33,7 @@ Value CBFunction::call(Builder *builder, const QList<Value> &params) {
 	std::vector<llvm::Value*> p;
 	QList<Parameter>::ConstIterator paramI = mParams.begin();
 	foreach(const Value &val, params) {
-		p.push_back(builder->llvmValue(val));
+		p.push_back(builder->llvmArgument(val));
 		paramI++;
 	}
 
@@ -42,7 +43,8 @@ Value CBFunction::call(Builder *builder, const QList<Value> &params) {
 		paramI++;
 	}
 
-	llvm::Value *ret = builder->irBuilder().CreateCall(mFunction, p);
+	llvm::CallInst *ret = builder->irBuilder().CreateCall(mFunction, p);
+	mFunctionValueType->setParameterAttributes(ret);
 	if (isCommand()) {
 		return Value();
 	}
@@ -22,6 +22,8 @@
 #include "valuetypesymbol.h"
 #include "customvaluetype.h"
 #include "structvaluetype.h"
+#include "fieldlayoutoptimizer.h"
+#include "arraydimensionanalyzer.h"
 #include <llvm/Assembly/AssemblyAnnotationWriter.h>
 
 
@@ -92,6 +94,10 @@ bool CodeGenerator::generate(ast::Program *program) {
 	}
 #endif
 
+	mFunctionDefinitions = program->functionDefinitions();
+	qDebug() << "Analyzing array dimensions...";
+	analyzeArrayDimensions(program);
+
 	qDebug() << "Starting code generation";
 	qDebug() << "Generating main scope...";
 	if (!generateMainScope(program->mainBlock())) {
@@ -178,6 +184,20 @@ bool CodeGenerator::addRuntimeFunctions() {
 	return true;
 }
 
+void CodeGenerator::analyzeArrayDimensions(ast::Program *program) {
+	ArrayDimensionAnalyzer analyzer;
+	analyzer.analyze(program->mainBlock(), &mMainScope);
+	for (ast::FunctionDefinition *def : program->functionDefinitions()) {
+		CBFunction *func = mSymbolCollector.functionByDefinition(def);
+		// Parameters can be given any array
+		for (const CBFunction::Parameter &param : func->parameters()) {
+			analyzer.addNonConstant(param.mVariableSymbol);
+		}
+		analyzer.analyze(def->block(), func->scope());
+	}
+	analyzer.apply();
+}
+
 bool CodeGenerator::generateFunctionDefinitions(const QList<ast::FunctionDefinition*> &functions) {
 	bool valid = true;
 	for (QList<ast::FunctionDefinition*>::ConstIterator i = functions.begin(); i != functions.end(); i++) {
@@ -192,13 +212,17 @@ bool CodeGenerator::generateGlobalVariables() {
 	for (Scope::Iterator i = mGlobalScope.begin(); i != mGlobalScope.end(); i++) {
 		if ((*i)->type() == Symbol::stVariable) {
 			VariableSymbol *varSym = static_cast<VariableSymbol*>(*i);
-			varSym->setAlloca(mBuilder->createGlobalVariable(
+			llvm::GlobalVariable *globalVar = mBuilder->createGlobalVariable(
 						varSym->valueType()->llvmType(),
 						false,
 						llvm::GlobalValue::PrivateLinkage,
 						varSym->valueType()->defaultValue(),
 						("CB_Global_" + varSym->name()).toStdString()
-						));
+						);
+			if (!varSym->valueType()->isStruct()) {
+				mBuilder->setTBAATag(globalVar, mBuilder->globalVariableTBAA(varSym->name()));
+			}
+			varSym->setAlloca(globalVar);
 		}
 	}
 	return true;
@@ -208,13 +232,56 @@ bool CodeGenerator::generateFunctions(const QList<ast::FunctionDefinition*> &fun
 	bool valid = true;
 	for (QList<ast::FunctionDefinition*>::ConstIterator i = functions.begin(); i != functions.end(); i++) {
 		CBFunction *func = mSymbolCollector.functionByDefinition(*i);
+		setFastMath(func->function(), isFastMathFunction(*i));
 		valid &= mFuncCodeGen.generate(mBuilder, (*i)->block(), func, &mGlobalScope);
 	}
+	setFastMath(0, false);
 	return valid;
 }
 
 bool CodeGenerator::generateMainScope(ast::Block *block) {
-	return mFuncCodeGen.generateMainBlock(mBuilder, block, mRuntime.cbMain(), &mMainScope, &mGlobalScope);
+	// The main scope consists of the code outside functions in every file, so a '$FastMath
+	// directive of one file doesn't enable fast-math for it. Only the setting does.
+	setFastMath(mRuntime.cbMain(), mSettings.fastMath());
+	bool valid = mFuncCodeGen.generateMainBlock(mBuilder, block, mRuntime.cbMain(), &mMainScope, &mGlobalScope);
+	setFastMath(0, false);
+	return valid;
+}
+
+bool CodeGenerator::isFileLevelFastMathDirective(const CodePoint &directive) const {
+	for (ast::FunctionDefinition *function : mFunctionDefinitions) {
+		if (function->codePoint().file() == directive.file() &&
+				function->codePoint().line() <= directive.line() && directive.line() <= function->endCodePoint().line()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// A '$FastMath directive inside a function enables fast-math for the function and
+// a directive outside functions for every function in the same file.
+bool CodeGenerator::isFastMathFunction(ast::FunctionDefinition *function) const {
+	if (mSettings.fastMath()) return true;
+	for (const CodePoint &directive : mFastMathDirectives) {
+		if (directive.file() != function->codePoint().file()) continue;
+		if (function->codePoint().line() <= directive.line() && directive.line() <= function->endCodePoint().line()) return true;
+		if (isFileLevelFastMathDirective(directive)) return true;
+	}
+	return false;
+}
+
+void CodeGenerator::setFastMath(llvm::Function *function, bool enabled) {
+	mBuilder->setFastMath(enabled);
+#if LLVM_VERSION_MINOR >= 4
+	// Lets the backend contract and approximate float operations of the function
+	if (function && enabled) {
+		function->addFnAttr("unsafe-fp-math", "true");
+		function->addFnAttr("no-nans-fp-math", "true");
+		function->addFnAttr("no-infs-fp-math", "true");
+	}
+#else
+	Q_UNUSED(function);
+#endif
 }
 
 void CodeGenerator::generateInitializers() {
@@ -234,7 +301,7 @@ void CodeGenerator::generateTypeInitializers() {
 	for (Symbol *sym : mGlobalScope) {
 		if (sym->type() == Symbol::stType) {
 			TypeSymbol *type = static_cast<TypeSymbol*>(sym);
-			type->initializeType(mBuilder);
+			type->initializeType(mBuilder, mSettings.contiguousTypes().contains(type->name(), Qt::CaseInsensitive));
 		}
 	}
 }
@@ -262,6 +329,12 @@ void CodeGenerator::addPredefinedConstantSymbols() {
 }
 
 bool CodeGenerator::generateTypesAndStructes(ast::Program *program) {
+	FieldLayoutOptimizer layoutOptimizer(mRuntime.dataLayout());
+	if (mSettings.optimizeFieldLayout()) {
+		layoutOptimizer.countAccesses(program);
+	}
+	const FieldLayoutOptimizer *optimizer = mSettings.optimizeFieldLayout() ? &layoutOptimizer : 0;
+
 	for (ast::TypeDefinition* def : program->typeDefinitions()) {
 		Symbol *sym = mGlobalScope.find(def->identifier()->name());
 		assert(sym && sym->type() == Symbol::stType);
@@ -275,7 +348,7 @@ bool CodeGenerator::generateTypesAndStructes(ast::Program *program) {
 	while (!notGeneratedValueTypes.isEmpty()) {
 		for (QList<StructValueType*>::Iterator i = notGeneratedValueTypes.begin(); i != notGeneratedValueTypes.end();) {
 			StructValueType *structValueType = *i;
-			if (structValueType->generateLLVMType()) {
+			if (structValueType->generateLLVMType(optimizer)) {
 				i = notGeneratedValueTypes.erase(i);
 			} else {
 				++i;
@@ -284,10 +357,16 @@ bool CodeGenerator::generateTypesAndStructes(ast::Program *program) {
 	}
 
 
+	for (StructValueType *structValueType : mRuntime.valueTypeCollection().structValueTypes()) {
+		if (mSettings.soaStructs().contains(structValueType->name(), Qt::CaseInsensitive)) {
+			structValueType->setSoAArrays(true);
+		}
+	}
+
 	for (QList<ast::TypeDefinition*>::ConstIterator i = program->typeDefinitions().begin(); i != program->typeDefinitions().end(); i++) {
 		ast::TypeDefinition *def = *i;
 		TypeSymbol *type = static_cast<TypeSymbol*>(mGlobalScope.find(def->identifier()->name()));
-		type->createTypePointerValueType(mBuilder);
+		type->createTypePointerValueType(mBuilder, optimizer);
 	}
 
 
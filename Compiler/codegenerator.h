@@ -15,6 +15,7 @@ class CodeGenerator : public QObject{
 	public:
 		CodeGenerator(QObject *parent = 0);
 		bool initialize(const Settings &settings);
+		void setFastMathDirectives(const QList<CodePoint> &directives) { mFastMathDirectives = directives; }
 		bool generate(ast::Program *program);
 		bool createExecutable(const QString &path);
 	private:
@@ -24,8 +25,12 @@ class CodeGenerator : public QObject{
 		bool checkFunctions();
 		bool calculateConstants(ast::Program *program);
 		bool generateGlobalVariables();
+		void analyzeArrayDimensions(ast::Program *program);
 		bool generateFunctionDefinitions(const QList<ast::FunctionDefinition*> &functions);
 		bool generateMainScope(ast::Block *block);
+		bool isFileLevelFastMathDirective(const CodePoint &directive) const;
+		bool isFastMathFunction(ast::FunctionDefinition *function) const;
+		void setFastMath(llvm::Function *function, bool enabled);
 		void generateInitializers();
 		void generateStringLiterals();
 		void generateTypeInitializers();
@@ -44,6 +49,8 @@ class CodeGenerator : public QObject{
 		Scope mMainScope;
 		FunctionCodeGenerator mFuncCodeGen;
 		QMap<ast::FunctionDefinition *, CBFunction *> mCBFunctions;
+		QList<CodePoint> mFastMathDirectives;
+		QList<ast::FunctionDefinition*> mFunctionDefinitions;
 		Builder *mBuilder;
 
 		llvm::BasicBlock *mInitializationBlock;
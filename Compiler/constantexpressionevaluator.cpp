@@ -51,7 +51,7 @@ ConstantValue ConstantExpressionEvaluator::evaluate(ast::Expression *node) {
 			case ast::ExpressionNode::opMultiply:
 				result = ConstantValue::multiply(op1, op2, flags); break;
 			case ast::ExpressionNode::opDivide:
-				result = ConstantValue::add(op1, op2, flags); break;
+				result = ConstantValue::divide(op1, op2, flags); break;
 			case ast::ExpressionNode::opMod:
 				result = ConstantValue::mod(op1, op2, flags); break;
 			case ast::ExpressionNode::opPower:
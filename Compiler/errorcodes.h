@@ -133,6 +133,7 @@ enum ErrorCode {
 	ecCodeGenerationFailed,
 
 	ecTypeHasMultipleFieldsWithSameName,
+	ecGosubInFunction,
 
 	ecWTF
 
@@ -0,0 +1,169 @@
+#include "fieldlayoutoptimizer.h"
+#include "llvm.h"
+#include <algorithm>
+
+// Weight of an access inside a loop compared to the enclosing block
+static const int loopAccessWeight = 8;
+static const int maxLoopAccessWeight = 8 * 8 * 8;
+
+FieldLayoutOptimizer::FieldLayoutOptimizer(const llvm::DataLayout &dataLayout) :
+	mDataLayout(dataLayout),
+	mLoopDepth(0) {
+}
+
+void FieldLayoutOptimizer::countAccesses(ast::Program *program) {
+	mFieldOwners.clear();
+	mAccessCounts.clear();
+	mLoopDepth = 0;
+	for (ast::TypeDefinition *def : program->typeDefinitions()) {
+		collectFieldOwners(def->identifier()->name(), def->fields());
+	}
+	for (ast::StructDefinition *def : program->structDefinitions()) {
+		collectFieldOwners(def->identifier()->name(), def->fields());
+	}
+	program->accept(this);
+}
+
+void FieldLayoutOptimizer::collectFieldOwners(const QString &typeName, const QList<ast::Node*> &fields) {
+	for (ast::Node *field : fields) {
+		if (field->type() != ast::Node::ntVariable) continue;
+		QString name = field->cast<ast::Variable>()->identifier()->name();
+		QMap<QString, QString>::Iterator i = mFieldOwners.find(name);
+		if (i == mFieldOwners.end()) {
+			mFieldOwners.insert(name, typeName);
+		}
+		else if (i.value() != typeName) {
+			i.value() = QString();
+		}
+	}
+}
+
+void FieldLayoutOptimizer::addAccess(const QString &fieldName, int weight) {
+	// Accesses of a name shared by several types can't be attributed to any of them
+	QString owner = mFieldOwners.value(fieldName);
+	if (owner.isEmpty()) return;
+	mAccessCounts[qMakePair(owner, fieldName)] += weight;
+}
+
+QList<int> FieldLayoutOptimizer::layout(const QString &typeName, const QList<QString> &fieldNames, const QList<llvm::Type*> &fieldTypes, uint64_t startOffset) const {
+	struct Field {
+		int mIndex;
+		int mAccessCount;
+		unsigned mAlignment;
+		uint64_t mSize;
+	};
+
+	QList<Field> hot;
+	QList<Field> cold;
+	int totalAccessCount = 0;
+	for (const QString &name : fieldNames) {
+		totalAccessCount += mAccessCounts.value(qMakePair(typeName, name), 0);
+	}
+	for (int i = 0; i < fieldNames.size(); i++) {
+		Field f;
+		f.mIndex = i;
+		f.mAccessCount = mAccessCounts.value(qMakePair(typeName, fieldNames.at(i)), 0);
+		f.mAlignment = mDataLayout.getABITypeAlignment(fieldTypes.at(i));
+		f.mSize = mDataLayout.getTypeAllocSize(fieldTypes.at(i));
+
+		// A field is hot if it's accessed at least as often as an average field of the structure
+		if (f.mAccessCount > 0 && f.mAccessCount * fieldNames.size() >= totalAccessCount) {
+			hot.append(f);
+		}
+		else {
+			cold.append(f);
+		}
+	}
+
+	// Within a group the fields are placed in the order of decreasing alignment, which needs no padding between them.
+	// A smaller field is taken first, if it fills the gap left by the previous fields.
+	QList<int> order;
+	uint64_t offset = startOffset;
+	for (QList<Field> *group : {&hot, &cold}) {
+		std::stable_sort(group->begin(), group->end(), [](const Field &a, const Field &b) {
+			if (a.mAlignment != b.mAlignment) return a.mAlignment > b.mAlignment;
+			return a.mAccessCount > b.mAccessCount;
+		});
+		while (!group->isEmpty()) {
+			int selected = 0;
+			for (int i = 0; i < group->size(); i++) {
+				if (offset % group->at(i).mAlignment == 0) {
+					selected = i;
+					break;
+				}
+			}
+			Field f = group->takeAt(selected);
+			offset = llvm::RoundUpToAlignment(offset, f.mAlignment) + f.mSize;
+			order.append(f.mIndex);
+		}
+	}
+	return order;
+}
+
+bool FieldLayoutOptimizer::actBefore(ast::Expression *n) {
+	int weight = 1;
+	for (int i = 0; i < mLoopDepth && weight < maxLoopAccessWeight; i++) {
+		weight *= loopAccessWeight;
+	}
+
+	for (ast::ExpressionNode *op : n->operations()) {
+		if (op->op() != ast::ExpressionNode::opMember) continue;
+		ast::Node *memberId = op->operand();
+		switch (memberId->type()) {
+			case ast::Node::ntIdentifier:
+				addAccess(memberId->cast<ast::Identifier>()->name(), weight);
+				break;
+			case ast::Node::ntVariable:
+				addAccess(memberId->cast<ast::Variable>()->identifier()->name(), weight);
+				break;
+			default:
+				break;
+		}
+	}
+	return false;
+}
+
+bool FieldLayoutOptimizer::actBefore(ast::WhileStatement *) {
+	mLoopDepth++;
+	return false;
+}
+
+bool FieldLayoutOptimizer::actBefore(ast::RepeatForeverStatement *) {
+	mLoopDepth++;
+	return false;
+}
+
+bool FieldLayoutOptimizer::actBefore(ast::RepeatUntilStatement *) {
+	mLoopDepth++;
+	return false;
+}
+
+bool FieldLayoutOptimizer::actBefore(ast::ForToStatement *) {
+	mLoopDepth++;
+	return false;
+}
+
+bool FieldLayoutOptimizer::actBefore(ast::ForEachStatement *) {
+	mLoopDepth++;
+	return false;
+}
+
+void FieldLayoutOptimizer::actAfter(ast::WhileStatement *) {
+	mLoopDepth--;
+}
+
+void FieldLayoutOptimizer::actAfter(ast::RepeatForeverStatement *) {
+	mLoopDepth--;
+}
+
+void FieldLayoutOptimizer::actAfter(ast::RepeatUntilStatement *) {
+	mLoopDepth--;
+}
+
+void FieldLayoutOptimizer::actAfter(ast::ForToStatement *) {
+	mLoopDepth--;
+}
+
+void FieldLayoutOptimizer::actAfter(ast::ForEachStatement *) {
+	mLoopDepth--;
+}
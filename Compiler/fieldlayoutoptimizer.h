@@ -0,0 +1,61 @@
+#ifndef FIELDLAYOUTOPTIMIZER_H
+#define FIELDLAYOUTOPTIMIZER_H
+#include "astvisitor.h"
+#include <QMap>
+#include <QList>
+#include <QString>
+#include <QPair>
+#include <stdint.h>
+
+namespace llvm {
+	class Type;
+	class DataLayout;
+}
+
+/**
+ * @brief The FieldLayoutOptimizer class decides the order of the fields of Types and Structs.
+ * Fields accessed often are placed first and the fields are ordered so that little padding is needed.
+ * The access counts are collected from the member accesses of the program, fields accessed inside loops weigh more.
+ * The types of the receivers aren't known yet, so only the accesses of the field names declared by a single Type or Struct are counted.
+ */
+class FieldLayoutOptimizer : protected ast::Visitor {
+	public:
+		FieldLayoutOptimizer(const llvm::DataLayout &dataLayout);
+
+		/**
+		 * @brief countAccesses Counts the member accesses of every function and the main block.
+		 */
+		void countAccesses(ast::Program *program);
+
+		/**
+		 * @brief layout Returns the order, in which the fields should be placed.
+		 * @param typeName Name of the Type or Struct.
+		 * @param fieldNames Names of the fields in the declaration order.
+		 * @param fieldTypes Types of the fields in the declaration order.
+		 * @param startOffset Offset of the first field from the beginning of the structure.
+		 * @return Indices of fieldNames/fieldTypes in the new order.
+		 */
+		QList<int> layout(const QString &typeName, const QList<QString> &fieldNames, const QList<llvm::Type*> &fieldTypes, uint64_t startOffset) const;
+	private:
+		void collectFieldOwners(const QString &typeName, const QList<ast::Node*> &fields);
+		void addAccess(const QString &fieldName, int weight);
+		bool actBefore(ast::Expression *n);
+		bool actBefore(ast::WhileStatement *n);
+		bool actBefore(ast::RepeatForeverStatement *n);
+		bool actBefore(ast::RepeatUntilStatement *n);
+		bool actBefore(ast::ForToStatement *n);
+		bool actBefore(ast::ForEachStatement *n);
+		void actAfter(ast::WhileStatement *n);
+		void actAfter(ast::RepeatForeverStatement *n);
+		void actAfter(ast::RepeatUntilStatement *n);
+		void actAfter(ast::ForToStatement *n);
+		void actAfter(ast::ForEachStatement *n);
+
+		const llvm::DataLayout &mDataLayout;
+		// Field name -> the Type or Struct declaring it, or an empty string if several do
+		QMap<QString, QString> mFieldOwners;
+		QMap<QPair<QString, QString>, int> mAccessCounts;
+		int mLoopDepth;
+};
+
+#endif // FIELDLAYOUTOPTIMIZER_H
@@ -0,0 +1,278 @@
+#include "fortoboundsanalyzer.h"
+#include "scope.h"
+#include "variablesymbol.h"
+#include "functionsymbol.h"
+#include "valuetype.h"
+
+ForToBoundsAnalyzer::ForToBoundsAnalyzer(Scope *localScope, Scope *globalScope) :
+	mLocalScope(localScope),
+	mGlobalScope(globalScope),
+	mLoopVariable(0),
+	mHasJumps(false),
+	mHasLabels(false),
+	mHasGosubs(false),
+	mCountedLoop(false),
+	mConditionalDepth(0),
+	mCallsUserFunctions(false) {
+}
+
+bool ForToBoundsAnalyzer::analyze(ast::ForToStatement *n) {
+	mLoopVariable = 0;
+	mWrittenSymbols.clear();
+	mHasJumps = false;
+	mHasLabels = false;
+	mHasGosubs = false;
+	mCountedLoop = false;
+	mConditionalDepth = 0;
+	mCallsUserFunctions = false;
+	mCandidates.clear();
+	mHoistedChecks.clear();
+	mHoistedSubscripts.clear();
+
+	ast::Node *from = n->from();
+	if (from->type() == ast::Node::ntExpression) {
+		ast::Expression *expr = from->cast<ast::Expression>();
+		if (expr->operations().size() != 1 || expr->operations().first()->op() != ast::ExpressionNode::opAssign) return false;
+		from = expr->firstOperand();
+	}
+	mLoopVariable = findVariable(from);
+	if (!mLoopVariable) return false;
+
+	n->block()->accept(this);
+
+	// The loop variable can be kept in a register only if the body doesn't modify it
+	// and nothing can jump inside the loop past the loop header. Subroutines called with Gosub
+	// aren't part of the body, so they could modify the variable too.
+	mCountedLoop = !mHasLabels && !mHasGosubs && !mWrittenSymbols.contains(mLoopVariable) && !(isGlobal(mLoopVariable) && mCallsUserFunctions);
+
+	// Labels make it possible to jump inside the loop without going through the checks
+	// and jumps out of the loop mean that the whole range isn't necessarily accessed.
+	if (mHasJumps) return false;
+	if (mWrittenSymbols.contains(mLoopVariable)) return false;
+	if (isGlobal(mLoopVariable) && mCallsUserFunctions) return false;
+	if (!isInvariant(n->to())) return false;
+
+	for (const QPair<ast::ArraySubscript*, ArrayDimension> &candidate : mCandidates) {
+		VariableSymbol *array = candidate.second.first;
+		if (mWrittenSymbols.contains(array)) continue;
+		if (isGlobal(array) && mCallsUserFunctions) continue;
+
+		if (!mHoistedChecks.contains(candidate.second)) {
+			mHoistedChecks.append(candidate.second);
+		}
+		mHoistedSubscripts.insert(QPair<ast::ArraySubscript*, int>(candidate.first, candidate.second.second));
+	}
+	return !mHoistedChecks.isEmpty();
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::Expression *n) {
+	if (n->associativity() != ast::Expression::RightToLeft) return false;
+
+	// a = b = c writes to every operand except the last one
+	ast::Node *target = n->firstOperand();
+	for (ast::ExpressionNode *op : n->operations()) {
+		if (op->op() != ast::ExpressionNode::opAssign) break;
+		Symbol *sym = findSymbol(target);
+		if (sym) mWrittenSymbols.insert(sym);
+		target = op->operand();
+	}
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::VariableDefinition *n) {
+	Symbol *sym = findSymbol(n->identifier());
+	if (sym) mWrittenSymbols.insert(sym);
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::ArrayInitialization *n) {
+	Symbol *sym = findSymbol(n->identifier());
+	if (sym) mWrittenSymbols.insert(sym);
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::ForEachStatement *n) {
+	Symbol *sym = findSymbol(n->variable());
+	if (sym) mWrittenSymbols.insert(sym);
+	mConditionalDepth++;
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::FunctionCall *n) {
+	Symbol *sym = findSymbol(n->function());
+	if (sym && sym->type() == Symbol::stFunctionOrCommand) {
+		for (Function *func : static_cast<FunctionSymbol*>(sym)->functions()) {
+			if (!func->isRuntimeFunction()) mCallsUserFunctions = true;
+		}
+	}
+	else {
+		// Calling through a function value, can't know what is called.
+		mCallsUserFunctions = true;
+	}
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::ArraySubscript *n) {
+	VariableSymbol *array = findVariable(n->array());
+	if (!array || !array->valueType()->isArray()) return false;
+
+	QList<ast::Node*> indices;
+	if (n->subscript()->type() == ast::Node::ntList) {
+		for (ast::ChildNodeIterator i = n->subscript()->childNodesBegin(); i != n->subscript()->childNodesEnd(); i++) {
+			indices.append(*i);
+		}
+	}
+	else {
+		indices.append(n->subscript());
+	}
+
+	// Only subscripts executed on every iteration can be checked before the loop
+	if (mConditionalDepth > 0) return false;
+
+	int dim = 0;
+	for (ast::Node *index : indices) {
+		if (findVariable(index) == mLoopVariable) {
+			mCandidates.append(QPair<ast::ArraySubscript*, ArrayDimension>(n, ArrayDimension(array, dim)));
+		}
+		dim++;
+	}
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::Label *) {
+	mHasJumps = true;
+	mHasLabels = true;
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::Goto *) {
+	mHasJumps = true;
+	return true;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::Gosub *) {
+	mHasJumps = true;
+	mHasGosubs = true;
+	return true;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::Return *) {
+	mHasJumps = true;
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::Exit *) {
+	mHasJumps = true;
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::IfStatement *) {
+	mConditionalDepth++;
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::WhileStatement *) {
+	mConditionalDepth++;
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::RepeatForeverStatement *) {
+	mConditionalDepth++;
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::RepeatUntilStatement *) {
+	mConditionalDepth++;
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::ForToStatement *) {
+	mConditionalDepth++;
+	return false;
+}
+
+bool ForToBoundsAnalyzer::actBefore(ast::SelectStatement *) {
+	mConditionalDepth++;
+	return false;
+}
+
+void ForToBoundsAnalyzer::actAfter(ast::IfStatement *) {
+	mConditionalDepth--;
+}
+
+void ForToBoundsAnalyzer::actAfter(ast::WhileStatement *) {
+	mConditionalDepth--;
+}
+
+void ForToBoundsAnalyzer::actAfter(ast::RepeatForeverStatement *) {
+	mConditionalDepth--;
+}
+
+void ForToBoundsAnalyzer::actAfter(ast::RepeatUntilStatement *) {
+	mConditionalDepth--;
+}
+
+void ForToBoundsAnalyzer::actAfter(ast::ForToStatement *) {
+	mConditionalDepth--;
+}
+
+void ForToBoundsAnalyzer::actAfter(ast::ForEachStatement *) {
+	mConditionalDepth--;
+}
+
+void ForToBoundsAnalyzer::actAfter(ast::SelectStatement *) {
+	mConditionalDepth--;
+}
+
+Symbol *ForToBoundsAnalyzer::findSymbol(ast::Node *n) const {
+	switch (n->type()) {
+		case ast::Node::ntIdentifier:
+			return mLocalScope->find(n->cast<ast::Identifier>()->name());
+		case ast::Node::ntVariable:
+			return mLocalScope->find(n->cast<ast::Variable>()->identifier()->name());
+		default:
+			return 0;
+	}
+}
+
+VariableSymbol *ForToBoundsAnalyzer::findVariable(ast::Node *n) const {
+	Symbol *sym = findSymbol(n);
+	if (sym && sym->type() == Symbol::stVariable) return static_cast<VariableSymbol*>(sym);
+	return 0;
+}
+
+bool ForToBoundsAnalyzer::isInvariant(ast::Node *n) const {
+	switch (n->type()) {
+		case ast::Node::ntInteger:
+		case ast::Node::ntFloat:
+		case ast::Node::ntString:
+			return true;
+		case ast::Node::ntIdentifier:
+		case ast::Node::ntVariable: {
+			Symbol *sym = findSymbol(n);
+			if (!sym) return false;
+			if (sym->type() == Symbol::stConstant) return true;
+			if (sym->type() != Symbol::stVariable) return false;
+			VariableSymbol *var = static_cast<VariableSymbol*>(sym);
+			if (mWrittenSymbols.contains(var)) return false;
+			return !(isGlobal(var) && mCallsUserFunctions);
+		}
+		case ast::Node::ntUnary:
+			return isInvariant(n->cast<ast::Unary>()->operand());
+		case ast::Node::ntExpression: {
+			ast::Expression *expr = n->cast<ast::Expression>();
+			if (!isInvariant(expr->firstOperand())) return false;
+			for (ast::ExpressionNode *op : expr->operations()) {
+				if (op->op() == ast::ExpressionNode::opAssign || op->op() == ast::ExpressionNode::opMember) return false;
+				if (!isInvariant(op->operand())) return false;
+			}
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+bool ForToBoundsAnalyzer::isGlobal(VariableSymbol *var) const {
+	return mGlobalScope->findOnlyThisScope(var->name()) == var;
+}
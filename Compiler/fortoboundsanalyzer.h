@@ -0,0 +1,98 @@
+#ifndef FORTOBOUNDSANALYZER_H
+#define FORTOBOUNDSANALYZER_H
+#include "astvisitor.h"
+#include <QSet>
+#include <QList>
+#include <QPair>
+
+class Scope;
+class Symbol;
+class VariableSymbol;
+
+/**
+ * @brief The ForToBoundsAnalyzer class finds the array subscripts inside a For-To loop, which are indexed
+ * directly with the loop variable and executed on every iteration. Bounds checks of those subscripts
+ * can be done once before the loop by checking the range of the loop variable.
+ * It also tells whether the loop variable is modified only by the loop itself.
+ */
+class ForToBoundsAnalyzer : protected ast::Visitor {
+	public:
+		typedef QPair<VariableSymbol*, int> ArrayDimension;
+
+		ForToBoundsAnalyzer(Scope *localScope, Scope *globalScope);
+
+		/**
+		 * @brief analyze Analyzes the For-To loop.
+		 * @return True, if at least one bounds check can be hoisted out of the loop.
+		 */
+		bool analyze(ast::ForToStatement *n);
+
+		/**
+		 * @return The loop variable or 0 if it couldn't be resolved.
+		 */
+		VariableSymbol *loopVariable() const { return mLoopVariable; }
+
+		/**
+		 * @return True, if the loop variable is only modified by the loop itself and the loop can be generated as a counted loop.
+		 */
+		bool isCountedLoop() const { return mCountedLoop; }
+
+		/**
+		 * @return Array dimensions, which should be checked against the range of the loop variable before the loop.
+		 */
+		QList<ArrayDimension> hoistedChecks() const { return mHoistedChecks; }
+
+		/**
+		 * @return Subscripts and dimensions whose bounds checks are covered by hoistedChecks().
+		 */
+		QSet<QPair<ast::ArraySubscript*, int> > hoistedSubscripts() const { return mHoistedSubscripts; }
+	private:
+		bool actBefore(ast::Expression *n);
+		bool actBefore(ast::VariableDefinition *n);
+		bool actBefore(ast::ArrayInitialization *n);
+		bool actBefore(ast::ForEachStatement *n);
+		bool actBefore(ast::FunctionCall *n);
+		bool actBefore(ast::ArraySubscript *n);
+		bool actBefore(ast::Label *n);
+		bool actBefore(ast::Goto *n);
+		bool actBefore(ast::Gosub *n);
+		bool actBefore(ast::Return *n);
+		bool actBefore(ast::Exit *n);
+
+		bool actBefore(ast::IfStatement *n);
+		bool actBefore(ast::WhileStatement *n);
+		bool actBefore(ast::RepeatForeverStatement *n);
+		bool actBefore(ast::RepeatUntilStatement *n);
+		bool actBefore(ast::ForToStatement *n);
+		bool actBefore(ast::SelectStatement *n);
+		void actAfter(ast::IfStatement *n);
+		void actAfter(ast::WhileStatement *n);
+		void actAfter(ast::RepeatForeverStatement *n);
+		void actAfter(ast::RepeatUntilStatement *n);
+		void actAfter(ast::ForToStatement *n);
+		void actAfter(ast::ForEachStatement *n);
+		void actAfter(ast::SelectStatement *n);
+
+		Symbol *findSymbol(ast::Node *n) const;
+		VariableSymbol *findVariable(ast::Node *n) const;
+		bool isInvariant(ast::Node *n) const;
+		bool isGlobal(VariableSymbol *var) const;
+
+		Scope *mLocalScope;
+		Scope *mGlobalScope;
+		VariableSymbol *mLoopVariable;
+
+		QSet<Symbol*> mWrittenSymbols;
+		bool mHasJumps;
+		bool mHasLabels;
+		bool mHasGosubs;
+		bool mCountedLoop;
+		int mConditionalDepth;
+		bool mCallsUserFunctions;
+
+		QList<QPair<ast::ArraySubscript*, ArrayDimension> > mCandidates;
+		QList<ArrayDimension> mHoistedChecks;
+		QSet<QPair<ast::ArraySubscript*, int> > mHoistedSubscripts;
+};
+
+#endif // FORTOBOUNDSANALYZER_H
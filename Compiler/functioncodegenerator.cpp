@@ -13,16 +13,32 @@
 #include "arrayvaluetype.h"
 #include "intvaluetype.h"
 #include "shortvaluetype.h"
+#include "floatvaluetype.h"
 #include "bytevaluetype.h"
 #include "typepointervaluetype.h"
+#include "typevaluetype.h"
 #include "booleanvaluetype.h"
+#include "stringvaluetype.h"
 #include "liststringjoin.h"
 #include "castcostcalculator.h"
 #include "cbfunction.h"
 #include "structvaluetype.h"
+#include "fortoboundsanalyzer.h"
 
 #define CHECK_UNREACHABLE(codePoint) if (checkUnreachable(codePoint)) return;
 
+// The maximum depth of nested Gosubs
+static const int gosubStackSize = 256;
+
+static bool containsGosub(ast::Node *n) {
+	if (n->type() == ast::Node::ntGosub) return true;
+	for (int i = 0; i < n->childNodeCount(); i++) {
+		ast::Node *child = n->childNode(i);
+		if (child && containsGosub(child)) return true;
+	}
+	return false;
+}
+
 struct CodeGeneratorError {
 		CodeGeneratorError(ErrorCodes::ErrorCode ec) : mErrorCodes(ec) { }
 		ErrorCodes::ErrorCode errorCode() const { return mErrorCodes; }
@@ -53,6 +69,10 @@ bool FunctionCodeGenerator::generate(Builder *builder, ast::Node *block, CBFunct
 	mBuilder = builder;
 	mReturnType = func->returnValue();
 	mUnresolvedGotos.clear();
+	mGosubStack = 0;
+	mGosubDepth = 0;
+	mGosubReturnBlocks.clear();
+	mGosubReturns.clear();
 
 	llvm::BasicBlock *firstBasicBlock = llvm::BasicBlock::Create(builder->context(), "firstBB", mFunction);
 	mBuilder->setInsertPoint(firstBasicBlock);
@@ -87,6 +107,10 @@ bool FunctionCodeGenerator::generateMainBlock(Builder *builder, ast::Node *block
 	mMainFunction = true;
 	mReturnType = 0;
 	mUnresolvedGotos.clear();
+	mGosubStack = 0;
+	mGosubDepth = 0;
+	mGosubReturnBlocks.clear();
+	mGosubReturns.clear();
 
 	llvm::BasicBlock *firstBasicBlock = llvm::BasicBlock::Create(builder->context(), "firstBB", func);
 	mBuilder->setInsertPoint(firstBasicBlock);
@@ -102,6 +126,7 @@ bool FunctionCodeGenerator::generateMainBlock(Builder *builder, ast::Node *block
 	mBuilder->returnVoid();
 
 	resolveGotos();
+	resolveGosubReturns();
 
 	return mValid;
 }
@@ -286,10 +311,6 @@ void FunctionCodeGenerator::visit(ast::RepeatUntilStatement *n) {
 void FunctionCodeGenerator::visit(ast::ForToStatement *n) {
 	CHECK_UNREACHABLE(n->codePoint());
 
-	llvm::BasicBlock *condBB = createBasicBlock("ForToCondBB");
-	llvm::BasicBlock *blockBB = createBasicBlock("forBodyBB");
-	llvm::BasicBlock *endBB = createBasicBlock("endForBB");
-
 	Value value = generate(n->from());
 	if (!value.isReference()) {
 		emit error(ErrorCodes::ecReferenceRequired, tr("Expression should return a reference to a variable"), n->from()->codePoint());
@@ -307,10 +328,50 @@ void FunctionCodeGenerator::visit(ast::ForToStatement *n) {
 	OperationFlags flags;
 	bool positiveStep = ConstantValue::greaterEqual(step, ConstantValue(0), flags).toBool();
 
+	// In counted mode the end value is evaluated only once before the loop
+	Value to;
+	if (mSettings->countedForLoops()) {
+		to = generate(n->to());
+	}
+
+	// With other steps the loop variable might never reach the end value, so only its first
+	// and last values are known for unit steps
+	bool unitStep = (step.type() == ConstantValue::Integer || step.type() == ConstantValue::Short || step.type() == ConstantValue::Byte) &&
+			(step.toInt() == 1 || step.toInt() == -1);
+	QSet<QPair<ast::ArraySubscript*, int> > hoistedBoundsChecks;
+	if (mSettings->boundsCheck() && unitStep) {
+		hoistedBoundsChecks = generateHoistedBoundsChecks(n, value, to, positiveStep);
+		mHoistedBoundsChecks += hoistedBoundsChecks;
+	}
+
+	if (to.isValid() && generateCountedForLoop(n, value, to, step, positiveStep)) {
+		mHoistedBoundsChecks -= hoistedBoundsChecks;
+		return;
+	}
+
+	// The end value is loaded from memory in the condition, because a Gosub in the body makes the
+	// condition reachable without going through the code before the loop.
+	bool endEvaluatedOnce = to.isValid();
+	llvm::Value *toStorage = 0;
+	if (endEvaluatedOnce && !to.isConstant()) {
+		if (to.isReference()) to = mBuilder->load(to);
+		toStorage = createEntryBlockAlloca(to.valueType()->llvmType(), "forToEnd");
+		mBuilder->irBuilder().CreateStore(mBuilder->llvmValue(to), toStorage);
+	}
+
+	llvm::BasicBlock *condBB = createBasicBlock("ForToCondBB");
+	llvm::BasicBlock *blockBB = createBasicBlock("forBodyBB");
+	llvm::BasicBlock *endBB = createBasicBlock("endForBB");
+
 	mBuilder->branch(condBB);
 	mBuilder->setInsertPoint(condBB);
 
-	Value to = generate(n->to());
+	if (!endEvaluatedOnce) {
+		to = generate(n->to());
+	}
+	else if (toStorage) {
+		to = Value(to.valueType(), mBuilder->irBuilder().CreateLoad(toStorage), false);
+	}
 	Value cond;
 	if (positiveStep) {
 		cond = mBuilder->lessEqual(value, to);
@@ -330,7 +391,77 @@ void FunctionCodeGenerator::visit(ast::ForToStatement *n) {
 	}
 	mUnreachableBasicBlock = false;
 	mExitStack.pop();
+	mHoistedBoundsChecks -= hoistedBoundsChecks;
 	mBuilder->setInsertPoint(endBB);
+	if (endEvaluatedOnce) {
+		if (toStorage) to = Value(to.valueType(), mBuilder->irBuilder().CreateLoad(toStorage), false);
+		mBuilder->destruct(to);
+	}
+}
+
+// Generates the For-To loop with an Integer loop variable in the canonical counted form:
+// the loop is entered only if the first iteration is executed and the counter is kept in a phi node.
+// The variable itself is updated at the beginning of every iteration and after the loop, so
+// the loop body and the code after the loop see it like in the normal For-To loop.
+// Returns false without generating anything if the loop can't be generated as a counted loop.
+bool FunctionCodeGenerator::generateCountedForLoop(ast::ForToStatement *n, const Value &loopVar, const Value &to, const ConstantValue &step, bool positiveStep) {
+	if (loopVar.valueType() != mRuntime->intValueType() || step.type() != ConstantValue::Integer) return false;
+	if (!(to.valueType() == mRuntime->intValueType() || to.valueType() == mRuntime->shortValueType() || to.valueType() == mRuntime->byteValueType())) return false;
+
+	ForToBoundsAnalyzer analyzer(mLocalScope, mGlobalScope);
+	analyzer.analyze(n);
+	if (!analyzer.loopVariable() || analyzer.loopVariable()->alloca_() != loopVar.value() || !analyzer.isCountedLoop()) return false;
+
+	llvm::IRBuilder<> &irBuilder = mBuilder->irBuilder();
+	llvm::BasicBlock *blockBB = createBasicBlock("forBodyBB");
+	llvm::BasicBlock *latchExitBB = createBasicBlock("forLatchExitBB");
+	llvm::BasicBlock *endBB = createBasicBlock("endForBB");
+
+	llvm::Value *start = mBuilder->llvmValue(loopVar);
+	llvm::Value *end = mBuilder->llvmValue(mBuilder->toInt(to));
+	llvm::Value *stepValue = irBuilder.getInt32(step.toInt());
+	llvm::BasicBlock *preheaderBB = irBuilder.GetInsertBlock();
+	llvm::Value *entered = positiveStep ? irBuilder.CreateICmpSLE(start, end) : irBuilder.CreateICmpSGE(start, end);
+	irBuilder.CreateCondBr(entered, blockBB, endBB);
+
+	mBuilder->setInsertPoint(blockBB);
+	llvm::PHINode *counter = irBuilder.CreatePHI(irBuilder.getInt32Ty(), 2, "forCounter");
+	counter->addIncoming(start, preheaderBB);
+	mBuilder->store(loopVar, Value(mRuntime->intValueType(), counter));
+
+	mExitStack.push(endBB);
+	n->block()->accept(this);
+
+	if (!mUnreachableBasicBlock) {
+		llvm::Value *next;
+		llvm::Value *cond;
+		if (step.toInt() == 1 || step.toInt() == -1) {
+			// The counter reaches the end value exactly, so the exit test can't overflow.
+			next = irBuilder.CreateAdd(counter, stepValue);
+			cond = irBuilder.CreateICmpNE(counter, end);
+		}
+		else {
+			// The next value may overflow, so the distance to the end value is compared to the step
+			// instead. The counter hasn't passed the end value, so the distance fits to an unsigned integer.
+			next = irBuilder.CreateAdd(counter, stepValue);
+			llvm::Value *distance = positiveStep ? irBuilder.CreateSub(end, counter) : irBuilder.CreateSub(counter, end);
+			int64_t stepSize = positiveStep ? (int64_t)step.toInt() : -(int64_t)step.toInt();
+			cond = irBuilder.CreateICmpUGE(distance, irBuilder.getInt32((uint32_t)stepSize));
+		}
+		counter->addIncoming(next, irBuilder.GetInsertBlock());
+		irBuilder.CreateCondBr(cond, blockBB, latchExitBB);
+
+		mBuilder->setInsertPoint(latchExitBB);
+		mBuilder->store(loopVar, Value(mRuntime->intValueType(), next));
+		mBuilder->branch(endBB);
+	}
+	else {
+		latchExitBB->eraseFromParent();
+	}
+	mUnreachableBasicBlock = false;
+	mExitStack.pop();
+	mBuilder->setInsertPoint(endBB);
+	return true;
 }
 
 void FunctionCodeGenerator::visit(ast::ForEachStatement *n) {
@@ -377,36 +508,67 @@ void FunctionCodeGenerator::visit(ast::ForEachStatement *n) {
 			emit error(ErrorCodes::ecInvalidAssignment, tr("The type of the variable \"%1\" doesn't match the container item type \"%2\"").arg(var.valueType()->name(), valueType->name()), n->codePoint());
 			return;
 		}
+		// The loop variable points to the current element, which doesn't exist as a whole in a SoA array
+		if (array->isSoA()) {
+			emit error(ErrorCodes::ecNotContainer, tr("For-Each can't iterate arrays of \"%1\", because they store the fields in separate columns. Use For-To instead").arg(valueType->name()), n->container()->codePoint());
+			return;
+		}
 
 		llvm::Value *alloc = varSym->alloca_();
+		llvm::IRBuilder<> &irBuilder = mBuilder->irBuilder();
 
-
+		// The current and the end position are kept in memory and loaded where they are needed. A Gosub in
+		// the body makes the block after it reachable from every Return, so values computed before it
+		// can't be used after it.
 		llvm::Value *arrayData = array->dataArray(mBuilder, container);
-		llvm::Value *arrayDataPtr = mBuilder->irBuilder().CreateAlloca(arrayData->getType());
+		llvm::Value *arrayDataPtr = createEntryBlockAlloca(arrayData->getType(), "forEachPosition");
+		llvm::Value *arrayEndPtr = createEntryBlockAlloca(arrayData->getType(), "forEachEnd");
 		llvm::Value *totalSize = array->totalSize(mBuilder, container);
-		llvm::Value *arrayEndPtr = mBuilder->irBuilder().CreateGEP(arrayData, totalSize);
-		mBuilder->irBuilder().CreateStore(arrayData, arrayDataPtr);
+		irBuilder.CreateStore(irBuilder.CreateGEP(arrayData, totalSize), arrayEndPtr);
+		irBuilder.CreateStore(arrayData, arrayDataPtr);
 		mBuilder->branch(condBB);
 
 		mBuilder->setInsertPoint(condBB);
-		arrayData = mBuilder->irBuilder().CreateLoad(arrayDataPtr);
-		llvm::Value *cond = mBuilder->irBuilder().CreateICmpNE(arrayData, arrayEndPtr);
-		mBuilder->irBuilder().CreateCondBr(cond, blockBB, endBB);
+		llvm::Value *cond = irBuilder.CreateICmpNE(irBuilder.CreateLoad(arrayDataPtr), irBuilder.CreateLoad(arrayEndPtr));
+		irBuilder.CreateCondBr(cond, blockBB, endBB);
 
+		// For the same reason the loop variable can't point to the element, if the body contains a Gosub.
+		// It gets a copy of the element instead, which is written back after the body.
+		bool copyElement = containsGosub(n->block());
+		llvm::BasicBlock *exitBB = endBB;
 		mBuilder->setInsertPoint(blockBB);
-		arrayData = mBuilder->irBuilder().CreateLoad(arrayDataPtr);
-		varSym->setAlloca(arrayData);
-		mExitStack.push(endBB);
+		if (copyElement) {
+			mBuilder->store(Value(valueType, alloc, true), Value(valueType, irBuilder.CreateLoad(arrayDataPtr), true));
+			exitBB = createBasicBlock("forEachExitBB");
+		}
+		else {
+			varSym->setAlloca(irBuilder.CreateLoad(arrayDataPtr));
+		}
+		mExitStack.push(exitBB);
 
 		n->block()->accept(this);
 		if (!mUnreachableBasicBlock) {
-			arrayData = mBuilder->irBuilder().CreateGEP(arrayData, mBuilder->irBuilder().getInt32(1));
-			mBuilder->irBuilder().CreateStore(arrayData, arrayDataPtr);
+			arrayData = irBuilder.CreateLoad(arrayDataPtr);
+			if (copyElement) {
+				mBuilder->store(Value(valueType, arrayData, true), Value(valueType, alloc, true));
+			}
+			irBuilder.CreateStore(irBuilder.CreateGEP(arrayData, irBuilder.getInt32(1)), arrayDataPtr);
 			mBuilder->branch(condBB);
 		}
 		mUnreachableBasicBlock = false;
 		mExitStack.pop();
 
+		if (exitBB != endBB) {
+			if (exitBB->use_empty()) {
+				exitBB->eraseFromParent();
+			}
+			else {
+				mBuilder->setInsertPoint(exitBB);
+				mBuilder->store(Value(valueType, irBuilder.CreateLoad(arrayDataPtr), true), Value(valueType, alloc, true));
+				mBuilder->branch(endBB);
+			}
+		}
+
 		mBuilder->setInsertPoint(endBB);
 		varSym->setAlloca(alloc);
 	}
@@ -437,10 +599,12 @@ void FunctionCodeGenerator::visit(ast::SelectStatement *n) {
 	llvm::BasicBlock *endBlock = createBasicBlock("selectEndBB");
 
 	bool switchPossible = value.valueType() == mRuntime->intValueType() || value.valueType() == mRuntime->shortValueType() || value.valueType() == mRuntime->byteValueType();
+	bool stringSwitchPossible = value.valueType() == mRuntime->stringValueType();
 	QList<QPair<Value, llvm::BasicBlock*> > values;
 	for (ast::SelectCase *c : n->cases()) {
 		Value value = generate(c->value());
 		switchPossible &= value.isConstant() && (value.valueType() == mRuntime->intValueType() || value.valueType() == mRuntime->shortValueType() || value.valueType() == mRuntime->byteValueType());
+		stringSwitchPossible &= value.isConstant() && value.constant().type() == ConstantValue::String;
 		llvm::BasicBlock *basicBlock = createBasicBlock("caseBB");
 		mBuilder->setInsertPoint(basicBlock);
 		c->block()->accept(this);
@@ -472,6 +636,38 @@ void FunctionCodeGenerator::visit(ast::SelectStatement *n) {
 			switchInst->addCase(caseVal, pairs.second);
 		}
 	}
+	else if (stringSwitchPossible) {
+		// Switch on the hash of the selector and confirm the match with a single
+		// string comparison. Cases with colliding hashes are compared in order.
+		StringValueType *stringValueType = mRuntime->stringValueType();
+		llvm::Value *str = mBuilder->llvmValue(value);
+		llvm::Value *hash = stringValueType->stringHash(&mBuilder->irBuilder(), str);
+
+		QList<quint32> hashes;
+		QMap<quint32, QList<QPair<Value, llvm::BasicBlock*> > > hashCases;
+		for (const QPair<Value, llvm::BasicBlock*> &pair : values) {
+			quint32 h = StringValueType::constantStringHash(pair.first.constant().toString());
+			if (!hashCases.contains(h)) hashes.append(h);
+			hashCases[h].append(pair);
+		}
+
+		llvm::SwitchInst *switchInst = mBuilder->irBuilder().CreateSwitch(hash, defaultBlock, hashes.size());
+		for (quint32 h : hashes) {
+			llvm::BasicBlock *hashBlock = createBasicBlock("caseHashBB", endBlock);
+			switchInst->addCase(mBuilder->irBuilder().getInt32(h), hashBlock);
+			mBuilder->setInsertPoint(hashBlock);
+			const QList<QPair<Value, llvm::BasicBlock*> > &cases = hashCases[h];
+			for (int i = 0; i < cases.size(); i++) {
+				bool last = i + 1 == cases.size();
+				llvm::BasicBlock *nextBlock = last ? defaultBlock : createBasicBlock("caseCondBB", endBlock);
+				llvm::Value *caseStr = mBuilder->llvmValue(cases.at(i).first);
+				llvm::Value *isEqual = stringValueType->stringEquality(&mBuilder->irBuilder(), str, caseStr);
+				stringValueType->destructString(&mBuilder->irBuilder(), caseStr);
+				mBuilder->irBuilder().CreateCondBr(isEqual, cases.at(i).second, nextBlock);
+				if (!last) mBuilder->setInsertPoint(nextBlock);
+			}
+		}
+	}
 	else {
 		ValueType *valueType = value.valueType();
 		int index = 0;
@@ -520,7 +716,11 @@ void FunctionCodeGenerator::visit(ast::SelectStatement *n) {
 void FunctionCodeGenerator::visit(ast::Return *n) {
 	CHECK_UNREACHABLE(n->codePoint());
 	if (mMainFunction) {
-		assert("Implement gosub" && 0);
+		if (n->value()) {
+			emit error(ErrorCodes::ecGosubCannotReturnValue, tr("Return from Gosub can't return a value"), n->value()->codePoint());
+			throw CodeGeneratorError(ErrorCodes::ecGosubCannotReturnValue);
+		}
+		generateGosubReturn();
 	}
 	else {
 		if (n->value()) {
@@ -549,28 +749,52 @@ void FunctionCodeGenerator::visit(ast::Return *n) {
 void FunctionCodeGenerator::visit(ast::Goto *n) {
 	CHECK_UNREACHABLE(n->codePoint());
 
-	Symbol *sym = mLocalScope->find(n->label()->name());
-	if (!sym) {
-		emit error(ErrorCodes::ecCantFindSymbol, tr("Can't find label \"%1\"").arg(n->label()->name()), n->label()->codePoint());
-		return;
-	}
-	if (sym->type() != Symbol::stLabel) {
-		emit error(ErrorCodes::ecNotLabel, tr("Symbol \"%1\" isn't a label").arg(n->label()->name()), n->label()->codePoint());
-		return;
-	}
+	LabelSymbol *label = findLabel(n->label());
+	if (!label) return;
 
-	LabelSymbol *label = static_cast<LabelSymbol*>(sym);
-	if (label->basicBlock()) {
-		mBuilder->branch(label->basicBlock());
-	}
-	else {
-		mUnresolvedGotos.append(QPair<LabelSymbol*, llvm::BasicBlock*>(label, mBuilder->currentBasicBlock()));
-	}
+	branchToLabel(label);
 	mUnreachableBasicBlock = true;
 }
 
 void FunctionCodeGenerator::visit(ast::Gosub *n) {
-	assert("UNIMPLEMENTED FUNCTION" && 0);
+	CHECK_UNREACHABLE(n->codePoint());
+
+	if (!mMainFunction) {
+		emit error(ErrorCodes::ecGosubInFunction, tr("Gosub can't be used inside a function"), n->codePoint());
+		return;
+	}
+
+	LabelSymbol *label = findLabel(n->label());
+	if (!label) return;
+
+	// Gosub pushes the address of the block after it to the return stack and jumps to the label.
+	// Return pops the address and jumps back with indirectbr, so the subroutine stays inside the main function.
+	generateGosubStack();
+	llvm::IRBuilder<> &irBuilder = mBuilder->irBuilder();
+	llvm::BasicBlock *returnBB = createBasicBlock("gosubReturnBB");
+	llvm::BasicBlock *overflowBB = createBasicBlock("gosubOverflowBB");
+	llvm::BasicBlock *pushBB = createBasicBlock("gosubPushBB");
+
+	llvm::Value *depth = irBuilder.CreateLoad(mGosubDepth);
+	llvm::Value *overflow = irBuilder.CreateICmpSGE(depth, irBuilder.getInt32(gosubStackSize));
+	llvm::MDBuilder mdBuilder(mBuilder->context());
+	irBuilder.CreateCondBr(overflow, overflowBB, pushBB, mdBuilder.createBranchWeights(1, 1 << 20));
+
+	irBuilder.SetInsertPoint(overflowBB);
+	llvm::CallInst *call = irBuilder.CreateCall(mRuntime->gosubStackOverflowFunction());
+	call->setDoesNotReturn();
+	irBuilder.CreateUnreachable();
+
+	irBuilder.SetInsertPoint(pushBB);
+	llvm::Value *gepParams[2];
+	gepParams[0] = irBuilder.getInt32(0);
+	gepParams[1] = depth;
+	irBuilder.CreateStore(llvm::BlockAddress::get(mFunction, returnBB), irBuilder.CreateGEP(mGosubStack, gepParams));
+	irBuilder.CreateStore(irBuilder.CreateAdd(depth, irBuilder.getInt32(1)), mGosubDepth);
+	branchToLabel(label);
+	mGosubReturnBlocks.append(returnBB);
+
+	mBuilder->setInsertPoint(returnBB);
 }
 
 void FunctionCodeGenerator::visit(ast::Label *n) {
@@ -604,9 +828,76 @@ void FunctionCodeGenerator::visit(ast::Exit *n) {
 void FunctionCodeGenerator::visit(ast::KeywordFunctionCall *n) {
 	CHECK_UNREACHABLE(n->codePoint());
 
+	if (n->keyword() == ast::KeywordFunctionCall::SortType) {
+		generateSortType(n);
+		return;
+	}
 	emit warning(WarningCodes::wcUselessLineIgnored, tr("Ignored expression because it doesn't affect anything"), n->codePoint());
 }
 
+// SortType(TypeName, field [, descending])
+// The field is a name of a field, so it isn't generated like the other parameters.
+void FunctionCodeGenerator::generateSortType(ast::KeywordFunctionCall *n) {
+	QList<ast::Node*> params;
+	if (n->parameters()->type() == ast::Node::ntList) {
+		for (ast::ChildNodeIterator i = n->parameters()->childNodesBegin(); i != n->parameters()->childNodesEnd(); i++) {
+			params.append(*i);
+		}
+	}
+	else {
+		params.append(n->parameters());
+	}
+	if (params.size() < 2 || params.size() > 3) {
+		emit error(ErrorCodes::ecWrongNumberOfParameters, tr("SortType takes 2 or 3 parameters, a type, a field and optionally a descending flag"), n->codePoint());
+		throw CodeGeneratorError(ErrorCodes::ecWrongNumberOfParameters);
+	}
+
+	Value type = generate(params.at(0));
+	if (!type.isValueType() || !type.valueType()->isTypePointer()) {
+		emit error(ErrorCodes::ecNotTypeName, tr("The first parameter of SortType should be a type. Invalid parameter type \"%1\"").arg(type.valueType()->name()), n->codePoint());
+		throw CodeGeneratorError(ErrorCodes::ecNotTypeName);
+	}
+	TypeSymbol *typeSymbol = static_cast<TypePointerValueType*>(type.valueType())->typeSymbol();
+
+	ast::Node *fieldNode = params.at(1);
+	QString fieldName;
+	switch (fieldNode->type()) {
+		case ast::Node::ntIdentifier:
+			fieldName = fieldNode->cast<ast::Identifier>()->name(); break;
+		case ast::Node::ntVariable:
+			fieldName = fieldNode->cast<ast::Variable>()->identifier()->name(); break;
+		default:
+			emit error(ErrorCodes::ecExpectingIdentifier, tr("The second parameter of SortType should be a field name"), fieldNode->codePoint());
+			throw CodeGeneratorError(ErrorCodes::ecExpectingIdentifier);
+	}
+	if (!typeSymbol->hasField(fieldName)) {
+		emit error(ErrorCodes::ecCantFindField, tr("Can't find field \"%1\"").arg(fieldName), fieldNode->codePoint());
+		throw CodeGeneratorError(ErrorCodes::ecCantFindField);
+	}
+
+	ValueType *fieldType = typeSymbol->field(fieldName).valueType();
+	TypeValueType::SortKeyType keyType;
+	if (fieldType == mRuntime->intValueType()) keyType = TypeValueType::skInteger;
+	else if (fieldType == mRuntime->floatValueType()) keyType = TypeValueType::skFloat;
+	else if (fieldType == mRuntime->stringValueType()) keyType = TypeValueType::skString;
+	else if (fieldType == mRuntime->shortValueType()) keyType = TypeValueType::skShort;
+	else if (fieldType == mRuntime->byteValueType()) keyType = TypeValueType::skByte;
+	else {
+		emit error(ErrorCodes::ecInvalidParameter, tr("SortType can't sort by field \"%1\" of type \"%2\". Only Integer, Float, String, Short and Byte fields are supported").arg(fieldName, fieldType->name()), fieldNode->codePoint());
+		throw CodeGeneratorError(ErrorCodes::ecInvalidParameter);
+	}
+
+	Value descending(ConstantValue(false), mRuntime);
+	if (params.size() == 3) {
+		descending = generate(params.at(2));
+		if (!descending.valueType()->isNumber()) {
+			emit error(ErrorCodes::ecNotInteger, tr("The third parameter of SortType should be an integer or a boolean. Given \"%1\"").arg(descending.valueType()->name()), n->codePoint());
+			throw CodeGeneratorError(ErrorCodes::ecNotInteger);
+		}
+		descending = mBuilder->toBoolean(descending);
+	}
+	mBuilder->sortTypeMembers(typeSymbol, fieldName, keyType, descending);
+}
 
 Value FunctionCodeGenerator::generate(ast::Integer *n) {
 	return Value(ConstantValue(n->value()), mRuntime);
@@ -911,6 +1202,10 @@ Value FunctionCodeGenerator::generate(ast::FunctionCall *n) {
 }
 
 Value FunctionCodeGenerator::generate(ast::KeywordFunctionCall *n) {
+	if (n->keyword() == ast::KeywordFunctionCall::SortType) {
+		emit error(ErrorCodes::ecInvalidParameter, tr("SortType doesn't return a value"), n->codePoint());
+		throw CodeGeneratorError(ErrorCodes::ecInvalidParameter);
+	}
 	QList<Value> paramValues = generateParameterList(n->parameters());
 	if (n->keyword() == ast::KeywordFunctionCall::ArraySize) {
 		if (paramValues.size() == 0 || paramValues.size() > 2) {
@@ -955,6 +1250,24 @@ Value FunctionCodeGenerator::generate(ast::KeywordFunctionCall *n) {
 		return result;
 	}
 
+	if (n->keyword() == ast::KeywordFunctionCall::ConvertToType) {
+		if (paramValues.size() != 2) {
+			emit error(ErrorCodes::ecWrongNumberOfParameters, tr("ConvertToType takes 2 parameters, a type and a handle"), n->codePoint());
+			throw CodeGeneratorError(ErrorCodes::ecWrongNumberOfParameters);
+		}
+		const Value &type = paramValues.first();
+		if (!type.isValueType() || !type.valueType()->isTypePointer()) {
+			emit error(ErrorCodes::ecNotTypeName, tr("The first parameter of ConvertToType should be a type. Invalid parameter type \"%1\"").arg(type.valueType()->name()), n->codePoint());
+			throw CodeGeneratorError(ErrorCodes::ecNotTypeName);
+		}
+		const Value &handle = paramValues.last();
+		if (!handle.valueType()->isNumber()) {
+			emit error(ErrorCodes::ecNotInteger, tr("The second parameter of ConvertToType should be an integer. Given \"%1\"").arg(handle.valueType()->name()), n->codePoint());
+			throw CodeGeneratorError(ErrorCodes::ecNotInteger);
+		}
+		TypePointerValueType *typePointerValueType = static_cast<TypePointerValueType*>(type.valueType());
+		return mBuilder->typeMemberFromHandle(typePointerValueType->typeSymbol(), mBuilder->toInt(handle));
+	}
 
 	if (paramValues.size() != 1) {
 		emit error(ErrorCodes::ecWrongNumberOfParameters, tr("This function takes one parameter"), n->codePoint());
@@ -1004,6 +1317,14 @@ Value FunctionCodeGenerator::generate(ast::KeywordFunctionCall *n) {
 			}
 			return mBuilder->afterTypeMember(param);
 		}
+		case ast::KeywordFunctionCall::ConvertToInteger: {
+			ValueType *valueType = param.valueType();
+			if (!valueType->isTypePointer()) {
+				emit error(ErrorCodes::ecNotTypePointer, tr("\"ConvertToInteger\" takes a type pointer as a parameter. Invalid parameter type \"%1\"").arg(valueType->name()), n->codePoint());
+				throw CodeGeneratorError(ErrorCodes::ecNotTypePointer);
+			}
+			return mBuilder->typeMemberHandle(param);
+		}
 		default:
 			assert("Invalid ast::KeywordFunctionCall::KeywordFunction" && 0);
 	}
@@ -1030,7 +1351,21 @@ Value FunctionCodeGenerator::generate(ast::ArraySubscript *n) {
 			index++;
 
 		}
-		return valType->arraySubscript(mBuilder, arr, params);
+
+		QList<int> constantSizes;
+		if (n->array()->type() == ast::Node::ntIdentifier || n->array()->type() == ast::Node::ntVariable) {
+			VariableSymbol *var = searchVariableSymbol(n->array());
+			constantSizes = var->constantDimensions();
+		}
+
+		if (mSettings->boundsCheck()) {
+			for (int dim = 0; dim < params.size(); dim++) {
+				if (!mHoistedBoundsChecks.contains(QPair<ast::ArraySubscript*, int>(n, dim))) {
+					valType->checkIndex(mBuilder, arr, dim, params.at(dim), constantSizes);
+				}
+			}
+		}
+		return valType->arraySubscript(mBuilder, arr, params, constantSizes);
 	} else {
 		emit error(ErrorCodes::ecNotArray, tr("Value isn't an array and  it doesn't have subscript operator"), n->codePoint());
 		throw CodeGeneratorError(ErrorCodes::ecNotArray);
@@ -1205,6 +1540,120 @@ QList<Value> FunctionCodeGenerator::generateParameterList(ast::Node *n) {
 	return result;
 }
 
+// Checks the array subscripts indexed with the loop variable once before the loop by checking
+// the first and the last value of the loop variable. The step has to be 1 or -1, so that the last
+// value is the end value. Returns the subscripts covered by the checks.
+QSet<QPair<ast::ArraySubscript*, int> > FunctionCodeGenerator::generateHoistedBoundsChecks(ast::ForToStatement *n, const Value &loopVar, const Value &toValue, bool positiveStep) {
+	ForToBoundsAnalyzer analyzer(mLocalScope, mGlobalScope);
+	if (!analyzer.analyze(n) || analyzer.loopVariable()->alloca_() != loopVar.value()) {
+		return QSet<QPair<ast::ArraySubscript*, int> >();
+	}
+	ValueType *loopVarType = loopVar.valueType();
+	if (!(loopVarType == mRuntime->intValueType() || loopVarType == mRuntime->shortValueType() || loopVarType == mRuntime->byteValueType())) {
+		return QSet<QPair<ast::ArraySubscript*, int> >();
+	}
+
+	// The end value has already been evaluated, if the loop is generated as a counted loop
+	Value to = toValue.isValid() ? toValue : generate(n->to());
+	if (!(to.valueType() == mRuntime->intValueType() || to.valueType() == mRuntime->shortValueType() || to.valueType() == mRuntime->byteValueType())) {
+		if (!toValue.isValid()) mBuilder->destruct(to);
+		return QSet<QPair<ast::ArraySubscript*, int> >();
+	}
+	Value from = mBuilder->load(loopVar);
+
+	llvm::BasicBlock *checkBB = createBasicBlock("forBoundsCheckBB");
+	llvm::BasicBlock *preheaderBB = createBasicBlock("forPreheaderBB");
+	Value entered = positiveStep ? mBuilder->lessEqual(from, to) : mBuilder->greaterEqual(from, to);
+	mBuilder->branch(entered, checkBB, preheaderBB);
+
+	mBuilder->setInsertPoint(checkBB);
+	for (const ForToBoundsAnalyzer::ArrayDimension &check : analyzer.hoistedChecks()) {
+		VariableSymbol *var = check.first;
+		ArrayValueType *arrayValueType = static_cast<ArrayValueType*>(var->valueType());
+		Value array(arrayValueType, var->alloca_(), true);
+		arrayValueType->checkIndex(mBuilder, array, check.second, from, var->constantDimensions());
+		arrayValueType->checkIndex(mBuilder, array, check.second, to, var->constantDimensions());
+	}
+	mBuilder->branch(preheaderBB);
+	mBuilder->setInsertPoint(preheaderBB);
+	return analyzer.hoistedSubscripts();
+}
+
+LabelSymbol *FunctionCodeGenerator::findLabel(ast::Identifier *n) {
+	Symbol *sym = mLocalScope->find(n->name());
+	if (!sym) {
+		emit error(ErrorCodes::ecCantFindSymbol, tr("Can't find label \"%1\"").arg(n->name()), n->codePoint());
+		return 0;
+	}
+	if (sym->type() != Symbol::stLabel) {
+		emit error(ErrorCodes::ecNotLabel, tr("Symbol \"%1\" isn't a label").arg(n->name()), n->codePoint());
+		return 0;
+	}
+	return static_cast<LabelSymbol*>(sym);
+}
+
+void FunctionCodeGenerator::branchToLabel(LabelSymbol *label) {
+	if (label->basicBlock()) {
+		mBuilder->branch(label->basicBlock());
+	}
+	else {
+		mUnresolvedGotos.append(QPair<LabelSymbol*, llvm::BasicBlock*>(label, mBuilder->currentBasicBlock()));
+	}
+}
+
+void FunctionCodeGenerator::generateGosubStack() {
+	if (mGosubStack) return;
+
+	llvm::BasicBlock &entryBlock = mFunction->getEntryBlock();
+	llvm::IRBuilder<> entryBuilder(&entryBlock, entryBlock.begin());
+	llvm::Type *stackType = llvm::ArrayType::get(entryBuilder.getInt8PtrTy(), gosubStackSize);
+	mGosubStack = entryBuilder.CreateAlloca(stackType, 0, "gosubStack");
+	mGosubDepth = entryBuilder.CreateAlloca(entryBuilder.getInt32Ty(), 0, "gosubDepth");
+	entryBuilder.CreateStore(entryBuilder.getInt32(0), mGosubDepth);
+}
+
+llvm::Value *FunctionCodeGenerator::createEntryBlockAlloca(llvm::Type *type, const llvm::Twine &name) {
+	llvm::BasicBlock &entryBlock = mFunction->getEntryBlock();
+	llvm::IRBuilder<> entryBuilder(&entryBlock, entryBlock.begin());
+	return entryBuilder.CreateAlloca(type, 0, name);
+}
+
+void FunctionCodeGenerator::generateGosubReturn() {
+	generateGosubStack();
+	llvm::IRBuilder<> &irBuilder = mBuilder->irBuilder();
+	llvm::BasicBlock *errorBB = createBasicBlock("returnWithoutGosubBB");
+	llvm::BasicBlock *popBB = createBasicBlock("gosubPopBB");
+
+	llvm::Value *depth = irBuilder.CreateLoad(mGosubDepth);
+	llvm::Value *empty = irBuilder.CreateICmpSLE(depth, irBuilder.getInt32(0));
+	llvm::MDBuilder mdBuilder(mBuilder->context());
+	irBuilder.CreateCondBr(empty, errorBB, popBB, mdBuilder.createBranchWeights(1, 1 << 20));
+
+	irBuilder.SetInsertPoint(errorBB);
+	llvm::CallInst *call = irBuilder.CreateCall(mRuntime->returnWithoutGosubFunction());
+	call->setDoesNotReturn();
+	irBuilder.CreateUnreachable();
+
+	irBuilder.SetInsertPoint(popBB);
+	depth = irBuilder.CreateSub(depth, irBuilder.getInt32(1));
+	irBuilder.CreateStore(depth, mGosubDepth);
+	llvm::Value *gepParams[2];
+	gepParams[0] = irBuilder.getInt32(0);
+	gepParams[1] = depth;
+	llvm::Value *address = irBuilder.CreateLoad(irBuilder.CreateGEP(mGosubStack, gepParams));
+
+	// The destinations are added when all the Gosubs have been generated
+	mGosubReturns.append(irBuilder.CreateIndirectBr(address));
+}
+
+void FunctionCodeGenerator::resolveGosubReturns() {
+	for (llvm::IndirectBrInst *ret : mGosubReturns) {
+		for (llvm::BasicBlock *bb : mGosubReturnBlocks) {
+			ret->addDestination(bb);
+		}
+	}
+}
+
 void FunctionCodeGenerator::resolveGotos() {
 	for (const QPair<LabelSymbol*, llvm::BasicBlock*> &g : mUnresolvedGotos) {
 		assert(g.first->basicBlock());
@@ -1249,7 +1698,14 @@ bool FunctionCodeGenerator::checkUnreachable(CodePoint cp) {
 void FunctionCodeGenerator::generateFunctionParameterAssignments(const QList<CBFunction::Parameter> &parameters) {
 	QList<CBFunction::Parameter>::ConstIterator pi = parameters.begin();
 	for (llvm::Function::arg_iterator i = mFunction->arg_begin(); i != mFunction->arg_end(); ++i) {
-		mBuilder->store(pi->mVariableSymbol, i);
+		ValueType *valueType = pi->mVariableSymbol->valueType();
+		if (valueType->isStruct()) {
+			// A byval pointer to the copy made by the caller
+			static_cast<StructValueType*>(valueType)->copy(mBuilder, pi->mVariableSymbol->alloca_(), i);
+		}
+		else {
+			mBuilder->store(pi->mVariableSymbol, i);
+		}
 		pi++;
 	}
 }
@@ -2,6 +2,7 @@
 #define FUNCTIONCODEGENERATOR_H
 
 #include <QObject>
+#include <QSet>
 #include "astvisitor.h"
 #include "settings.h"
 #include "scope.h"
@@ -56,6 +57,15 @@ class FunctionCodeGenerator : public QObject, protected ast::Visitor {
 		Function *findBestOverload(const QList<Function*> &functions, const QList<Value> &parameters, bool command, const CodePoint &cp);
 		QList<Value> generateParameterList(ast::Node *n);
 		void resolveGotos();
+		LabelSymbol *findLabel(ast::Identifier *n);
+		void branchToLabel(LabelSymbol *label);
+		void generateGosubStack();
+		llvm::Value *createEntryBlockAlloca(llvm::Type *type, const llvm::Twine &name = llvm::Twine());
+		void generateGosubReturn();
+		void resolveGosubReturns();
+		QSet<QPair<ast::ArraySubscript*, int> > generateHoistedBoundsChecks(ast::ForToStatement *n, const Value &loopVar, const Value &toValue, bool positiveStep);
+		void generateSortType(ast::KeywordFunctionCall *n);
+		bool generateCountedForLoop(ast::ForToStatement *n, const Value &loopVar, const Value &to, const ConstantValue &step, bool positiveStep);
 
 		bool generateAllocas();
 		void generateDestructors();
@@ -82,6 +92,13 @@ class FunctionCodeGenerator : public QObject, protected ast::Visitor {
 		QList<QPair<LabelSymbol*, llvm::BasicBlock*> > mUnresolvedGotos;
 		QStack<llvm::BasicBlock*> mExitStack;
 
+		// Return address stack of Gosubs in the main function
+		llvm::Value *mGosubStack;
+		llvm::Value *mGosubDepth;
+		QList<llvm::BasicBlock*> mGosubReturnBlocks;
+		QList<llvm::IndirectBrInst*> mGosubReturns;
+		QSet<QPair<ast::ArraySubscript*, int> > mHoistedBoundsChecks;
+
 		bool mValid;
 	signals:
 		void warning(int code, QString msg, CodePoint codePoint);
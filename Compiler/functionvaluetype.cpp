@@ -14,7 +14,8 @@ FunctionValueType::FunctionValueType(Runtime *r, Function *function) :
 	std::vector<llvm::Type*> params;
 	params.reserve(mParamTypes.size());
 	for (ValueType *vt : mParamTypes) {
-		params.push_back(vt->llvmType());
+		// Structs are passed as a pointer to a copy of the struct (byval) instead of as an aggregate value
+		params.push_back(vt->isStruct() ? vt->llvmType()->getPointerTo() : vt->llvmType());
 	}
 	if (mReturnType == 0) {
 		mType = llvm::FunctionType::get(llvm::Type::getVoidTy(r->module()->getContext()), params, false);
@@ -36,6 +37,21 @@ QString FunctionValueType::name() const {
 	}
 }
 
+void FunctionValueType::setParameterAttributes(llvm::Function *func) const {
+	unsigned index = 1;
+	for (ValueType *vt : mParamTypes) {
+		if (vt->isStruct()) func->addAttribute(index, llvm::Attribute::ByVal);
+		index++;
+	}
+}
+
+void FunctionValueType::setParameterAttributes(llvm::CallInst *call) const {
+	unsigned index = 1;
+	for (ValueType *vt : mParamTypes) {
+		if (vt->isStruct()) call->addAttribute(index, llvm::Attribute::ByVal);
+		index++;
+	}
+}
 
 llvm::Constant *FunctionValueType::defaultValue() const {
 	assert("FunctionValueType::defaultValue not implemented" && 0);
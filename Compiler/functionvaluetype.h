@@ -23,6 +23,11 @@ class FunctionValueType : public ValueType {
 		
 		const QList<ValueType*> &paramTypes() const { return mParamTypes; }
 		ValueType *returnType() const { return mReturnType; }
+		/**
+		 * @brief setParameterAttributes Marks the struct parameters of the function or the call byval.
+		 */
+		void setParameterAttributes(llvm::Function *func) const;
+		void setParameterAttributes(llvm::CallInst *call) const;
 		Function *function() const { return mFunction;  }
 	protected:
 		ValueType *mReturnType;
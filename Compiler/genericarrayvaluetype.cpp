@@ -7,7 +7,8 @@ GenericArrayValueType::GenericArrayValueType(llvm::PointerType *genericArrayPoin
 	mConstructFunction(0),
 	mRefFunction(0),
 	mDestructFunction(0),
-	mAssignmentFunction(0)
+	mAssignmentFunction(0),
+	mIndexOutOfBoundsFunction(0)
 {
 }
 
@@ -106,3 +107,16 @@ bool GenericArrayValueType::setRefFunction(llvm::Function *func) {
 	mRefFunction = func;
 	return true;
 }
+
+bool GenericArrayValueType::setIndexOutOfBoundsFunction(llvm::Function *func) {
+	llvm::FunctionType *funcTy = func->getFunctionType();
+	if (funcTy->getReturnType() != llvm::Type::getVoidTy(func->getContext())) return false;
+	if (funcTy->getNumParams() != 3) return false;
+	llvm::Type *intT = llvm::IntegerType::getIntNTy(mRuntime->module()->getContext(), mRuntime->dataLayout().getPointerSizeInBits());
+	for (llvm::FunctionType::param_iterator i = funcTy->param_begin(); i != funcTy->param_end(); i++) {
+		if (*i != intT) return false;
+	}
+
+	mIndexOutOfBoundsFunction = func;
+	return true;
+}
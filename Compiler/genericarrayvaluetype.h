@@ -30,16 +30,19 @@ public:
 	bool setDestructFunction(llvm::Function *f);
 	bool setRefFunction(llvm::Function *f);
 	bool setAssignmentFunction(llvm::Function *f);
+	bool setIndexOutOfBoundsFunction(llvm::Function *f);
 	llvm::Function *constructFunction() const { return mConstructFunction; }
 	llvm::Function *destructFunction() const { return mDestructFunction; }
 	llvm::Function *refFunction() const { return mRefFunction; }
 	llvm::Function *assignmentFunction() const { return mAssignmentFunction; }
+	llvm::Function *indexOutOfBoundsFunction() const { return mIndexOutOfBoundsFunction; }
 
 private:
 	llvm::Function *mConstructFunction;
 	llvm::Function *mRefFunction;
 	llvm::Function *mDestructFunction;
 	llvm::Function *mAssignmentFunction;
+	llvm::Function *mIndexOutOfBoundsFunction;
 };
 
 #endif // GENERICARRAYVALUETYPE_H
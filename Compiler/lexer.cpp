@@ -61,6 +61,9 @@ Lexer::Lexer()
 	mKeywords["before"] = Token::kBefore;
 	mKeywords["after"] = Token::kAfter;
 	mKeywords["arraysize"] = Token::kArraySize;
+	mKeywords["converttointeger"] = Token::kConvertToInteger;
+	mKeywords["converttotype"] = Token::kConvertToType;
+	mKeywords["sorttype"] = Token::kSortType;
 
 	mKeywords["include"] = Token::kInclude;
 }
@@ -110,9 +113,14 @@ Lexer::ReturnState Lexer::tokenize(const QString &file) {
 			continue;
 		}
 		if (*i == '\'') { //Single line comment
+			CodePoint commentCodePoint = codePoint(i, lineStart, line, curFilePath);
 			i++;
 			if (i == code.end()) return state;
+			QString::iterator commentStart = i;
 			readToEOL(i, code.end());
+			if (QString(commentStart, i - commentStart).trimmed().compare("$fastmath", Qt::CaseInsensitive) == 0) {
+				mFastMathDirectives.append(commentCodePoint);
+			}
 			if (i != code.end()) {
 				addToken(Token(Token::EOL, i, i + 1, codePoint(i, lineStart, line, curFilePath)));
 				++i;
@@ -54,11 +54,20 @@ class Lexer: public QObject
 
 
 		QList<QPair<QString, QString> > files() const {return mFiles; }
+
+		/**
+		 * @brief fastMathDirectives
+		 * @return Code points of the '$FastMath comments. A directive inside a function enables fast-math for
+		 * that function and a directive outside functions enables it for every function of the file. The code
+		 * outside functions is compiled with fast-math only if it's enabled in the settings.
+		 */
+		QList<CodePoint> fastMathDirectives() const { return mFastMathDirectives; }
 	private:
 
 		ReturnState tokenize(const QString &file);
 		QList<QPair<QString, QString> > mFiles; //File and code
 		QList<Token> mTokens;
+		QList<CodePoint> mFastMathDirectives;
 		QMap<QString, Token::Type> mKeywords;
 		Settings mSettings;
 
@@ -6,6 +6,7 @@
 #include <llvm/Pass.h>
 #include <llvm/PassManager.h>
 #include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/ValueMap.h>
 #include <llvm/Analysis/Verifier.h>
 #include <llvm/Assembly/PrintModulePass.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
@@ -32,12 +33,15 @@
 	#include <llvm/Support/IRReader.h>
 	#if LLVM_VERSION_MINOR == 2
 		#include <llvm/IRBuilder.h>
+		#include <llvm/MDBuilder.h>
 	#else
 		#include <llvm/Support/IRBuilder.h>
+		#include <llvm/Support/MDBuilder.h>
 	#endif
 #else
 
 	#include <llvm/IR/IRBuilder.h>
+	#include <llvm/IR/MDBuilder.h>
 	#include <llvm/IR/LLVMContext.h>
 	#include <llvm/IR/Module.h>
 	#include <llvm/IR/DerivedTypes.h>
@@ -100,6 +100,7 @@ int main(int argc, char *argv[]) {
 
 
 	qDebug() << "Code generator initialization took " << timer.elapsed() << "ms";
+	codeGenerator.setFastMathDirectives(lexer.fastMathDirectives());
 	timer.start();
 	if (!codeGenerator.generate(program)) {
 		errHandler.error(ErrorCodes::ecCodeGenerationFailed, errHandler.tr("Code generation failed"), CodePoint());
@@ -123,6 +123,9 @@ ast::Node *Parser::tryExpression(Parser::TokIterator &i) {
 		case Token::kAfter:
 		case Token::kBefore:
 		case Token::kArraySize:
+		case Token::kConvertToInteger:
+		case Token::kConvertToType:
+		case Token::kSortType:
 			return expectExpression(i);
 		default:
 			return 0;
@@ -1590,7 +1593,10 @@ ast::Node *Parser::expectPrimaryExpression(TokIterator &i) {
 		case Token::kLast:
 		case Token::kBefore:
 		case Token::kAfter:
-		case Token::kArraySize: {
+		case Token::kArraySize:
+		case Token::kConvertToInteger:
+		case Token::kConvertToType:
+		case Token::kSortType: {
 			ast::KeywordFunctionCall *ret;
 			switch (i->type()) {
 				case Token::kNew:
@@ -1605,6 +1611,12 @@ ast::Node *Parser::expectPrimaryExpression(TokIterator &i) {
 					ret = new ast::KeywordFunctionCall(ast::KeywordFunctionCall::After, i->codePoint()); break;
 				case Token::kArraySize:
 					ret = new ast::KeywordFunctionCall(ast::KeywordFunctionCall::ArraySize, i->codePoint()); break;
+				case Token::kConvertToInteger:
+					ret = new ast::KeywordFunctionCall(ast::KeywordFunctionCall::ConvertToInteger, i->codePoint()); break;
+				case Token::kConvertToType:
+					ret = new ast::KeywordFunctionCall(ast::KeywordFunctionCall::ConvertToType, i->codePoint()); break;
+				case Token::kSortType:
+					ret = new ast::KeywordFunctionCall(ast::KeywordFunctionCall::SortType, i->codePoint()); break;
 				default:
 					assert("WTF assertion");
 					ret = 0;
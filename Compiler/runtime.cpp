@@ -34,7 +34,9 @@ Runtime::Runtime():
 	mBooleanValueType(0),
 	mTypePointerCommonValueType(0),
 	mValueTypeCollection(this),
-	mDataLayout(0) {
+	mDataLayout(0),
+	mGosubStackOverflowFunction(0),
+	mReturnWithoutGosubFunction(0) {
 	assert(runtimeInstance == 0);
 	runtimeInstance = this;
 }
@@ -158,6 +160,12 @@ bool Runtime::isFreeFuntionValid() {
 	return mFreeFunction->getReturnType() == llvm::Type::getVoidTy(mModule->getContext());
 }
 
+bool Runtime::isRuntimeErrorFunctionValid(llvm::Function *func) {
+	if (!func) return false;
+	if (func->arg_size() != 0) return false;
+	return func->getReturnType() == llvm::Type::getVoidTy(mModule->getContext());
+}
+
 bool Runtime::loadFunctionMapping(const QString &functionMapping) {
 	QFile file(functionMapping);
 	if (!file.open(QFile::ReadOnly | QFile::Text)) {
@@ -314,6 +322,12 @@ bool Runtime::loadDefaultRuntimeFunctions() {
 		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_StringRef"), CodePoint());
 	}
 
+	func = mModule->getFunction("CB_StringHash");
+	if (!func || !mStringValueType->setHashFunction(func)) {
+		mValid = false;
+		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_StringHash"), CodePoint());
+	}
+
 	func = mModule->getFunction("CB_ArrayRef");
 	if (!func || !mGenericArrayValueType->setRefFunction(func)) {
 		mValid = false;
@@ -338,6 +352,12 @@ bool Runtime::loadDefaultRuntimeFunctions() {
 		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_ArrayAssign"), CodePoint());
 	}
 
+	func = mModule->getFunction("CB_ArrayIndexOutOfBounds");
+	if (!func || !mGenericArrayValueType->setIndexOutOfBoundsFunction(func)) {
+		mValid = false;
+		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_ArrayIndexOutOfBounds"), CodePoint());
+	}
+
 	mAllocatorFunction = mModule->getFunction("CB_Allocate");
 	if (!isAllocatorFunctionValid()) {
 		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_Allocate"), CodePoint());
@@ -350,12 +370,30 @@ bool Runtime::loadDefaultRuntimeFunctions() {
 		mValid = false;
 	}
 
+	mGosubStackOverflowFunction = mModule->getFunction("CB_GosubStackOverflow");
+	if (!isRuntimeErrorFunctionValid(mGosubStackOverflowFunction)) {
+		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_GosubStackOverflow"), CodePoint());
+		mValid = false;
+	}
+
+	mReturnWithoutGosubFunction = mModule->getFunction("CB_ReturnWithoutGosub");
+	if (!isRuntimeErrorFunctionValid(mReturnWithoutGosubFunction)) {
+		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_ReturnWithoutGosub"), CodePoint());
+		mValid = false;
+	}
+
 	func = mModule->getFunction("CB_ConstructType");
 	if (!func || !mTypeValueType->setConstructTypeFunction(func)) {
 		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_ConstructType"), CodePoint());
 		mValid = false;
 	}
 
+	func = mModule->getFunction("CB_ConstructContiguousType");
+	if (!func || !mTypeValueType->setConstructContiguousTypeFunction(func)) {
+		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_ConstructContiguousType"), CodePoint());
+		mValid = false;
+	}
+
 	func = mModule->getFunction("CB_New");
 	if (!func || !mTypeValueType->setNewFunction(func)) {
 		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_New"), CodePoint());
@@ -386,5 +424,23 @@ bool Runtime::loadDefaultRuntimeFunctions() {
 		mValid = false;
 	}
 
+	func = mModule->getFunction("CB_TypeMemberHandle");
+	if (!func || !mTypeValueType->setHandleFunction(func)) {
+		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_TypeMemberHandle"), CodePoint());
+		mValid = false;
+	}
+
+	func = mModule->getFunction("CB_TypeMemberFromHandle");
+	if (!func || !mTypeValueType->setFromHandleFunction(func)) {
+		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_TypeMemberFromHandle"), CodePoint());
+		mValid = false;
+	}
+
+	func = mModule->getFunction("CB_SortType");
+	if (!func || !mTypeValueType->setSortFunction(func)) {
+		emit error(ErrorCodes::ecInvalidRuntime, tr("RUNTIME: Invalid CB_SortType"), CodePoint());
+		mValid = false;
+	}
+
 	return mValid;
 }
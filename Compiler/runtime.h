@@ -61,6 +61,8 @@ class Runtime : public QObject {
 
 		llvm::Function *allocatorFunction() const { return mAllocatorFunction; }
 		llvm::Function *freeFunction() const { return mFreeFunction; }
+		llvm::Function *gosubStackOverflowFunction() const { return mGosubStackOverflowFunction; }
+		llvm::Function *returnWithoutGosubFunction() const { return mReturnWithoutGosubFunction; }
 
 		const llvm::DataLayout &dataLayout() const { return *mDataLayout; }
 		llvm::Type *typeLLVMType() const { return mTypeLLVMType; }
@@ -75,6 +77,7 @@ class Runtime : public QObject {
 		bool loadValueTypes(StringPool *strPool);
 		bool isAllocatorFunctionValid();
 		bool isFreeFuntionValid();
+		bool isRuntimeErrorFunctionValid(llvm::Function *func);
 		bool loadFunctionMapping(const QString &functionMapping);
 		bool loadCustomDataTypes(const QString &customDataTypes);
 
@@ -103,6 +106,8 @@ class Runtime : public QObject {
 
 		llvm::Function *mAllocatorFunction;
 		llvm::Function *mFreeFunction;
+		llvm::Function *mGosubStackOverflowFunction;
+		llvm::Function *mReturnWithoutGosubFunction;
 
 		llvm::Type *mTypeLLVMType;
 		llvm::Type *mTypeMemberLLVMType;
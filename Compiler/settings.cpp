@@ -7,7 +7,11 @@
 #include <QFileInfo>
 
 Settings::Settings() :
-	mFVD(false) {
+	mFVD(false),
+	mBoundsCheck(false),
+	mCountedForLoops(false),
+	mFastMath(false),
+	mOptimizeFieldLayout(false) {
 }
 
 bool Settings::loadDefaults() {
@@ -41,6 +45,36 @@ bool Settings::loadDefaults() {
 	if (var.isNull() ||  !var.canConvert(QMetaType::QString)) return false;
 	mDataTypes= var.toString();
 
+	//Optional, defaults to false
+	var = settings.value("codegen/bounds-check", false);
+	if (!var.canConvert(QMetaType::Bool)) return false;
+	mBoundsCheck = var.toBool();
+
+	//Optional, defaults to false
+	var = settings.value("codegen/counted-for-loops", false);
+	if (!var.canConvert(QMetaType::Bool)) return false;
+	mCountedForLoops = var.toBool();
+
+	//Optional, defaults to false
+	var = settings.value("codegen/fast-math", false);
+	if (!var.canConvert(QMetaType::Bool)) return false;
+	mFastMath = var.toBool();
+
+	//Optional, defaults to none
+	var = settings.value("codegen/contiguous-types", QStringList());
+	if (!var.canConvert(QMetaType::QStringList)) return false;
+	mContiguousTypes = var.toStringList();
+
+	//Optional, defaults to false
+	var = settings.value("codegen/optimize-field-layout", false);
+	if (!var.canConvert(QMetaType::Bool)) return false;
+	mOptimizeFieldLayout = var.toBool();
+
+	//Optional, defaults to none
+	var = settings.value("codegen/soa-structs", QStringList());
+	if (!var.canConvert(QMetaType::QStringList)) return false;
+	mSoAStructs = var.toStringList();
+
 	var = settings.value("opt/call");
 	if (var.isNull() ||  !var.canConvert(QMetaType::QString)) return false;
 	mOpt = var.toString();
@@ -87,7 +121,9 @@ bool Settings::callOpt(const QString &inputFile, const QString &outputFile) cons
 }
 
 bool Settings::callLLC(const QString &inputFile, const QString &outputFile) const {
-	QString cmd = mLLC.arg(mLLCFlags, inputFile, outputFile);
+	QString flags = mLLCFlags;
+	if (mFastMath) flags += " -enable-unsafe-fp-math -fp-contract=fast";
+	QString cmd = mLLC.arg(flags, inputFile, outputFile);
 	qDebug() << cmd;
 	int ret = QProcess::execute(cmd);
 	qDebug() << ret;
@@ -1,6 +1,7 @@
 #ifndef SETTINGS_H
 #define SETTINGS_H
 #include <QString>
+#include <QStringList>
 class Settings {
 	public:
 		Settings();
@@ -9,6 +10,12 @@ class Settings {
 		bool callLLC(const QString &inputFile, const QString &outputFile) const;
 		bool callLinker(const QString &inputFile, const QString &outputFile) const;
 		bool forceVariableDeclaration() const { return mFVD; }
+		bool boundsCheck() const { return mBoundsCheck; }
+		bool countedForLoops() const { return mCountedForLoops; }
+		bool fastMath() const { return mFastMath; }
+		QStringList contiguousTypes() const { return mContiguousTypes; }
+		bool optimizeFieldLayout() const { return mOptimizeFieldLayout; }
+		QStringList soaStructs() const { return mSoAStructs; }
 		QString defaultOutputFile() const { return mDefaultOutput; }
 		QString loadPath() const { return mLoadPath; }
 		QString runtimeLibraryPath() const { return mRuntimeLibrary; }
@@ -25,6 +32,12 @@ class Settings {
 		QString mLinkerFlags;
 
 		bool mFVD;
+		bool mBoundsCheck;
+		bool mCountedForLoops;
+		bool mFastMath;
+		QStringList mContiguousTypes;
+		bool mOptimizeFieldLayout;
+		QStringList mSoAStructs;
 		QString mDefaultOutput;
 		QString mRuntimeLibrary;
 		QString mFunctionMapping;
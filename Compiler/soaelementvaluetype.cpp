@@ -0,0 +1,125 @@
+#include "soaelementvaluetype.h"
+#include "structvaluetype.h"
+#include "builder.h"
+#include "abstractsyntaxtree.h"
+
+SoAElementValueType::SoAElementValueType(StructValueType *structValueType) :
+	ValueType(structValueType->runtime()),
+	mStructValueType(structValueType) {
+	llvm::Type *intPtrType = mRuntime->dataLayout().getIntPtrType(context());
+	mType = llvm::StructType::get(llvm::Type::getInt8PtrTy(context()), intPtrType, intPtrType, NULL);
+}
+
+QString SoAElementValueType::name() const {
+	return mStructValueType->name();
+}
+
+llvm::Constant *SoAElementValueType::defaultValue() const {
+	return llvm::Constant::getNullValue(mType);
+}
+
+int SoAElementValueType::size() const {
+	return mRuntime->dataLayout().getTypeAllocSize(mType);
+}
+
+ValueType::CastCost SoAElementValueType::castingCostToOtherValueType(const ValueType *to) const {
+	if (to == this) return ccNoCost;
+	if (to == mStructValueType) return ccNoCost;
+	return ccNoCast;
+}
+
+Value SoAElementValueType::cast(Builder *, const Value &v) const {
+	if (v.valueType() == this) return v;
+	return Value();
+}
+
+Value SoAElementValueType::generateOperation(Builder *builder, int opType, const Value &operand1, const Value &operand2, OperationFlags &operationFlags) const {
+	if (operand1.valueType() != this) {
+		operationFlags |= OperationFlag::NoSuchOperation;
+		return Value();
+	}
+
+	Value other = operand2;
+	if (other.valueType() == this) {
+		other = load(builder, operand2);
+	}
+	else if (other.valueType() != mStructValueType) {
+		operationFlags |= OperationFlag::NoSuchOperation;
+		return Value();
+	}
+
+	Value result;
+	if (opType == ast::ExpressionNode::opAssign) {
+		// Scatter the fields to their columns
+		for (int fieldIndex = 0; fieldIndex < mStructValueType->fields().size(); ++fieldIndex) {
+			Value f1 = field(builder, operand1, fieldIndex);
+			Value f2 = mStructValueType->field(builder, other, fieldIndex);
+			f1.valueType()->generateOperation(builder, ast::ExpressionNode::opAssign, f1, f2, operationFlags);
+			if (operationFlagsContainFatalFlags(operationFlags)) {
+				return Value();
+			}
+		}
+		result = operand1;
+	}
+	else {
+		Value element = load(builder, operand1);
+		result = mStructValueType->generateOperation(builder, opType, element, other, operationFlags);
+		builder->destruct(element);
+	}
+
+	if (other.valueType() != operand2.valueType()) {
+		builder->destruct(other);
+	}
+	return result;
+}
+
+Value SoAElementValueType::member(Builder *builder, const Value &a, const QString &memberName) const {
+	assert(a.valueType() == this);
+	int fieldIndex = mStructValueType->fieldIndex(memberName);
+	if (fieldIndex < 0) return Value();
+	return field(builder, a, fieldIndex);
+}
+
+ValueType *SoAElementValueType::memberType(const QString &memberName) const {
+	return mStructValueType->memberType(memberName);
+}
+
+Value SoAElementValueType::element(Builder *builder, llvm::Value *data, llvm::Value *elementCount, llvm::Value *index) const {
+	llvm::IRBuilder<> &irBuilder = builder->irBuilder();
+	llvm::Value *v = llvm::UndefValue::get(mType);
+	v = irBuilder.CreateInsertValue(v, data, 0);
+	v = irBuilder.CreateInsertValue(v, elementCount, 1);
+	v = irBuilder.CreateInsertValue(v, index, 2);
+	return Value(const_cast<SoAElementValueType*>(this), v, false);
+}
+
+Value SoAElementValueType::load(Builder *builder, const Value &element) const {
+	assert(element.valueType() == this);
+	llvm::Value *ret = llvm::UndefValue::get(mStructValueType->llvmType());
+	for (int fieldIndex = 0; fieldIndex < mStructValueType->fields().size(); ++fieldIndex) {
+		Value f = field(builder, element, fieldIndex);
+		Value fLoaded = f.valueType()->generateLoad(builder, f);
+		unsigned idx[1];
+		idx[0] = fieldIndex;
+		ret = builder->irBuilder().CreateInsertValue(ret, fLoaded.value(), idx);
+	}
+	return Value(mStructValueType, ret, false);
+}
+
+Value SoAElementValueType::field(Builder *builder, const Value &element, int fieldIndex) const {
+	const StructField &structField = mStructValueType->fields().at(fieldIndex);
+	llvm::IRBuilder<> &irBuilder = builder->irBuilder();
+	llvm::Value *v = builder->llvmValue(element);
+	llvm::Value *data = irBuilder.CreateExtractValue(v, 0);
+	llvm::Value *elementCount = irBuilder.CreateExtractValue(v, 1);
+	llvm::Value *index = irBuilder.CreateExtractValue(v, 2);
+
+	uint64_t offset = mRuntime->dataLayout().getStructLayout(mStructValueType->structType())->getElementOffset(fieldIndex);
+	llvm::Value *column = irBuilder.CreateGEP(data, irBuilder.CreateMul(elementCount, llvm::ConstantInt::get(elementCount->getType(), offset)));
+	column = irBuilder.CreateBitCast(column, structField.valueType()->llvmType()->getPointerTo());
+	llvm::Value *fieldPtr = irBuilder.CreateGEP(column, index);
+	if (!structField.valueType()->isStruct()) {
+		builder->setTBAATag(fieldPtr, builder->structFieldTBAA(mStructValueType->name(), structField.name()));
+	}
+	return Value(structField.valueType(), fieldPtr, true);
+}
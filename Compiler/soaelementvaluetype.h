@@ -0,0 +1,49 @@
+#ifndef SOAELEMENTVALUETYPE_H
+#define SOAELEMENTVALUETYPE_H
+#include "valuetype.h"
+
+class StructValueType;
+
+/**
+ * @brief The SoAElementValueType class is the value type of an element of a struct array, which stores
+ * every field of the struct in its own column (structure of arrays).
+ *
+ * The value is {i8* data, intptr elementCount, intptr index}. The column of a field starts
+ * (offset of the field in the struct) * elementCount bytes from the beginning of the data, so the columns
+ * fit in the same space as the elements stored in a row.
+ */
+class SoAElementValueType : public ValueType {
+	public:
+		SoAElementValueType(StructValueType *structValueType);
+		QString name() const;
+		bool isNamedValueType() const { return false; }
+		bool isTypePointer() const { return false; }
+		bool isNumber() const { return false; }
+		llvm::Constant *defaultValue() const;
+		int size() const;
+
+		CastCost castingCostToOtherValueType(const ValueType *to) const;
+		Value cast(Builder *builder, const Value &v) const;
+
+		Value generateOperation(Builder *builder, int opType, const Value &operand1, const Value &operand2, OperationFlags &operationFlags) const;
+		Value member(Builder *builder, const Value &a, const QString &memberName) const;
+		ValueType *memberType(const QString &memberName) const;
+
+		/**
+		 * @brief element Returns the element at index of the array data.
+		 */
+		Value element(Builder *builder, llvm::Value *data, llvm::Value *elementCount, llvm::Value *index) const;
+
+		/**
+		 * @brief load Gathers the fields of the element to a struct value.
+		 */
+		Value load(Builder *builder, const Value &element) const;
+
+		StructValueType *structValueType() const { return mStructValueType; }
+	private:
+		Value field(Builder *builder, const Value &element, int fieldIndex) const;
+
+		StructValueType *mStructValueType;
+};
+
+#endif // SOAELEMENTVALUETYPE_H
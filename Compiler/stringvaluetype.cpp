@@ -135,6 +135,18 @@ bool StringValueType::setRefFunction(llvm::Function *func) {
 	return true;
 }
 
+bool StringValueType::setHashFunction(llvm::Function *func) {
+	llvm::FunctionType *funcTy = func->getFunctionType();
+	if (funcTy->getReturnType() != llvm::Type::getInt32Ty(func->getContext())) return false;
+	if (funcTy->getNumParams() != 1) return false;
+	llvm::FunctionType::param_iterator i = funcTy->param_begin();
+	const llvm::Type *const arg1 = *i;
+	if (arg1 != mType) return false;
+
+	mHashFunction = func;
+	return true;
+}
+
 void StringValueType::assignString(llvm::IRBuilder<> *builder, llvm::Value *var, llvm::Value *string) {
 	builder->CreateCall2(mAssignmentFunction, var, string);
 }
@@ -217,6 +229,20 @@ void StringValueType::refString(llvm::IRBuilder<> *builder, llvm::Value *a) cons
 	builder->CreateCall(mRefFunction, a);
 }
 
+llvm::Value *StringValueType::stringHash(llvm::IRBuilder<> *builder, llvm::Value *str) {
+	return builder->CreateCall(mHashFunction, str);
+}
+
+quint32 StringValueType::constantStringHash(const QString &s) {
+	//32bit FNV-1a over UCS-4 characters
+	quint32 hash = 2166136261u;
+	for (uint c : s.toUcs4()) {
+		hash ^= c;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
 Value StringValueType::generateOperation(Builder *builder, int opType, const Value &operand1, const Value &operand2, OperationFlags &operationFlags) const {
 	return generateBasicTypeOperation(builder, opType, operand1, operand2, operationFlags);
 }
@@ -232,7 +258,7 @@ void StringValueType::generateDestructor(Builder *builder, const Value &value) {
 
 Value StringValueType::generateLoad(Builder *builder, const Value &var) const {
 	assert(var.isReference());
-	llvm::Value *v = builder->irBuilder().CreateLoad(var.value());
+	llvm::Value *v = builder->load(var.value());
 	refString(&builder->irBuilder(), v);
 	return Value(var.valueType(), v, false);
 }
@@ -19,6 +19,7 @@ class StringValueType : public ValueType {
 		bool setStringToFloatFunction(llvm::Function *func);
 		bool setEqualityFunction(llvm::Function *func);
 		bool setRefFunction(llvm::Function *func);
+		bool setHashFunction(llvm::Function *func);
 
 		void assignString(llvm::IRBuilder<> *builder, llvm::Value *var, llvm::Value *string);
 		llvm::Value *constructString(llvm::IRBuilder<> *builder, llvm::Value *globalStrPtr);
@@ -30,6 +31,10 @@ class StringValueType : public ValueType {
 		llvm::Value *stringAddition(llvm::IRBuilder<> *builder, llvm::Value *str1, llvm::Value *str2);
 		llvm::Value *stringEquality(llvm::IRBuilder<> *builder, llvm::Value *a, llvm::Value *b);
 		void refString(llvm::IRBuilder<> *builder, llvm::Value *a) const;
+		llvm::Value *stringHash(llvm::IRBuilder<> *builder, llvm::Value *str);
+
+		/** Calculates the hash of a string constant at compile time. Matches the hash calculated by CB_StringHash. */
+		static quint32 constantStringHash(const QString &s);
 
 		Value generateOperation(Builder *builder, int opType, const Value &operand1, const Value &operand2, OperationFlags &operationFlags) const;
 		Value generateOperation(Builder *builder, int opType, const Value &operand, OperationFlags &operationFlags) const;
@@ -57,6 +62,7 @@ class StringValueType : public ValueType {
 		llvm::Function *mStringToFloatFunction;
 		llvm::Function *mEqualityFunction;
 		llvm::Function *mRefFunction;
+		llvm::Function *mHashFunction;
 		StringPool *mStringPool;
 };
 
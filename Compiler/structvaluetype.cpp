@@ -5,12 +5,15 @@
 #include "abstractsyntaxtree.h"
 #include "genericstructvaluetype.h"
 #include "nullvaluetype.h"
+#include "fieldlayoutoptimizer.h"
+#include "soaelementvaluetype.h"
 
 StructValueType::StructValueType(const QString &name, const CodePoint &cp, Runtime *runtime) :
 	ValueType(runtime),
 	mName(name),
 	mCodePoint(cp),
-	mStructType(0) {
+	mStructType(0),
+	mSoAElementValueType(0) {
 
 }
 
@@ -18,12 +21,13 @@ StructValueType::StructValueType(const QString &name, const CodePoint &cp, const
 	ValueType(runtime),
 	mName(name),
 	mCodePoint(cp),
-	mStructType(0) {
+	mStructType(0),
+	mSoAElementValueType(0) {
 	setFields(fields);
 }
 
 StructValueType::~StructValueType() {
-
+	delete mSoAElementValueType;
 }
 
 bool StructValueType::containsValueType(const ValueType *valueType) const {
@@ -41,6 +45,18 @@ bool StructValueType::containsItself() const {
 	return containsValueType(this);
 }
 
+bool StructValueType::isPOD() const {
+	for (const StructField &f : mFields) {
+		if (f.valueType()->basicType() == ValueType::String || f.valueType()->isArray()) return false;
+		if (f.valueType()->isStruct() && !static_cast<StructValueType*>(f.valueType())->isPOD()) return false;
+	}
+	return true;
+}
+
+void StructValueType::copy(Builder *builder, llvm::Value *dest, llvm::Value *src) const {
+	const llvm::DataLayout &dataLayout = mRuntime->dataLayout();
+	builder->memCopy(src, dest, builder->llvmValue((int)dataLayout.getTypeAllocSize(mStructType)), dataLayout.getABITypeAlignment(mStructType));
+}
 
 QString StructValueType::name() const {
 	return mName;
@@ -54,6 +70,7 @@ ValueType::CastCost StructValueType::castingCostToOtherValueType(const ValueType
 
 Value StructValueType::cast(Builder *builder, const Value &v) const {
 	if (v.valueType() == this) return v;
+	if (mSoAElementValueType && v.valueType() == mSoAElementValueType) return mSoAElementValueType->load(builder, v);
 	return Value();
 }
 
@@ -62,7 +79,7 @@ llvm::Constant *StructValueType::defaultValue() const {
 }
 
 int StructValueType::size() const {
-	return mRuntime->dataLayout().getPointerSize();
+	return mRuntime->dataLayout().getTypeAllocSize(mStructType);
 }
 
 void StructValueType::setFields(const QList<StructField> &fields) {
@@ -73,14 +90,30 @@ void StructValueType::setFields(const QList<StructField> &fields) {
 }
 
 
-bool StructValueType::generateLLVMType() {
-	std::vector<llvm::Type*> body;
-	body.reserve(mFields.size());
-
+bool StructValueType::generateLLVMType(const FieldLayoutOptimizer *layoutOptimizer) {
 	for (const StructField &f : mFields) {
 		if (f.valueType()->isStruct()) {
 			if (!static_cast<StructValueType*>(f.valueType())->isGenerated()) return false;
 		}
+	}
+
+	if (layoutOptimizer) {
+		QList<QString> names;
+		QList<llvm::Type*> types;
+		for (const StructField &f : mFields) {
+			names.append(f.name());
+			types.append(f.valueType()->llvmType());
+		}
+		QList<StructField> fields;
+		for (int i : layoutOptimizer->layout(mName, names, types, 0)) {
+			fields.append(mFields.at(i));
+		}
+		setFields(fields);
+	}
+
+	std::vector<llvm::Type*> body;
+	body.reserve(mFields.size());
+	for (const StructField &f : mFields) {
 		body.push_back(f.valueType()->llvmType());
 	}
 
@@ -94,6 +127,12 @@ bool StructValueType::isGenerated() const {
 }
 
 Value StructValueType::generateOperation(Builder *builder, int opType, const Value &operand1, const Value &operand2, OperationFlags &operationFlags) const {
+	if (mSoAElementValueType && operand2.valueType() == mSoAElementValueType) {
+		Value element = mSoAElementValueType->load(builder, operand2);
+		Value result = generateOperation(builder, opType, operand1, element, operationFlags);
+		builder->destruct(element);
+		return result;
+	}
 	if (operand2.valueType() == mRuntime->nullValueType()) {
 		return generateOperation(builder, opType, operand1, builder->defaultValue(this), operationFlags);
 	}
@@ -105,6 +144,16 @@ Value StructValueType::generateOperation(Builder *builder, int opType, const Val
 					operationFlags |= OperationFlag::ReferenceRequired;
 					return Value();
 				}
+				// Strings and arrays have to be assigned one by one to keep their reference counts right
+				if (isPOD()) {
+					if (operand2.isReference()) {
+						copy(builder, operand1.value(), operand2.value());
+					}
+					else {
+						builder->store(operand1.value(), operand2.value());
+					}
+					return operand1;
+				}
 				for (int fieldIndex = 0; fieldIndex < mFields.size(); ++fieldIndex) {
 					Value f1 = this->field(builder, operand1, fieldIndex);
 					Value f2 = this->field(builder, operand2, fieldIndex);
@@ -161,7 +210,7 @@ void StructValueType::generateDestructor(Builder *builder, const Value &v) {
 	for (int fieldIndex = 0; fieldIndex < mFields.size(); ++fieldIndex) {
 		Value f = this->field(builder, v, fieldIndex);
 		if (f.isReference()) {
-			f = Value(f.valueType(), builder->irBuilder().CreateLoad(f.value()), false);
+			f = Value(f.valueType(), builder->load(f.value()), false);
 		}
 		builder->destruct(f);
 	}
@@ -169,6 +218,9 @@ void StructValueType::generateDestructor(Builder *builder, const Value &v) {
 
 Value StructValueType::generateLoad(Builder *builder, const Value &var) const {
 	assert(var.isReference());
+	if (isPOD()) {
+		return Value(var.valueType(), builder->load(var.value()), false);
+	}
 	llvm::Value *ret = llvm::UndefValue::get(llvmType());
 	for (int fieldIndex = 0; fieldIndex < mFields.size(); ++fieldIndex) {
 		Value f = field(builder, var, fieldIndex);
@@ -190,6 +242,23 @@ Value StructValueType::member(Builder *builder, const Value &a, const QString &m
 	return field(builder, a, fieldIndex);
 }
 
+int StructValueType::fieldIndex(const QString &fieldName) const {
+	QList<StructField>::ConstIterator fieldI = mFieldSearch.value(fieldName, mFields.end());
+	if (fieldI == mFields.end()) return -1;
+	return fieldI - mFields.begin();
+}
+
+void StructValueType::setSoAArrays(bool soa) {
+	if (soa == hasSoAArrays()) return;
+	if (soa) {
+		mSoAElementValueType = new SoAElementValueType(this);
+	}
+	else {
+		delete mSoAElementValueType;
+		mSoAElementValueType = 0;
+	}
+}
+
 ValueType *StructValueType::memberType(const QString &memberName) const {
 	QList<StructField>::ConstIterator fieldI = mFieldSearch.value(memberName, mFields.end());
 	if (fieldI != mFields.end()) {
@@ -201,9 +270,12 @@ ValueType *StructValueType::memberType(const QString &memberName) const {
 Value StructValueType::field(Builder *builder, const Value &a, int fieldIndex) const {
 	assert(a.valueType() == this);
 	if (a.isReference()) {
-		return Value(mFields.at(fieldIndex).valueType(),
-					 builder->irBuilder().CreateStructGEP(a.value(), fieldIndex),
-					 true);
+		const StructField &structField = mFields.at(fieldIndex);
+		llvm::Value *fieldPtr = builder->irBuilder().CreateStructGEP(a.value(), fieldIndex);
+		if (!structField.valueType()->isStruct()) {
+			builder->setTBAATag(fieldPtr, builder->structFieldTBAA(name(), structField.name()));
+		}
+		return Value(structField.valueType(), fieldPtr, true);
 	}
 	else {
 		unsigned ids[1] = {fieldIndex};
@@ -5,6 +5,9 @@
 #include <QMap>
 #include <QList>
 
+class FieldLayoutOptimizer;
+class SoAElementValueType;
+
 class StructField {
 	public:
 		StructField(const QString &name, ValueType *valueType, const CodePoint &cp);
@@ -29,6 +32,14 @@ class StructValueType : public ValueType {
 		~StructValueType();
 		bool containsValueType(const ValueType *valueType) const;
 		bool containsItself() const;
+		/**
+		 * @brief isPOD Returns true, if the struct doesn't contain strings or arrays, so it can be copied as plain memory.
+		 */
+		bool isPOD() const;
+		/**
+		 * @brief copy Copies the struct pointed by src to dest. Both are pointers to the struct type.
+		 */
+		void copy(Builder *builder, llvm::Value *dest, llvm::Value *src) const;
 
 		virtual QString name() const;
 		virtual CastCost castingCostToOtherValueType(const ValueType *to) const;
@@ -40,7 +51,11 @@ class StructValueType : public ValueType {
 		int size() const;
 		void setFields(const QList<StructField> &fields);
 		const CodePoint &codePoint() const { return mCodePoint; }
-		bool generateLLVMType();
+		/**
+		 * @brief generateLLVMType Generates the LLVM struct type, if the types of the fields are generated.
+		 * @param layoutOptimizer If not null, the fields are reordered as it suggests.
+		 */
+		bool generateLLVMType(const FieldLayoutOptimizer *layoutOptimizer = 0);
 		bool isGenerated() const;
 
 		bool isNamedValueType() const { return true; }
@@ -50,6 +65,18 @@ class StructValueType : public ValueType {
 		virtual Value member(Builder *builder, const Value &a, const QString &memberName) const;
 		virtual ValueType *memberType(const QString &memberName) const;
 		Value field(Builder *builder, const Value &v, int fieldIndex) const;
+		const QList<StructField> &fields() const { return mFields; }
+		/**
+		 * @brief fieldIndex Returns the index of the field or -1, if there isn't such field.
+		 */
+		int fieldIndex(const QString &fieldName) const;
+
+		/**
+		 * @brief setSoAArrays Makes the arrays of this struct store every field in its own column.
+		 */
+		void setSoAArrays(bool soa);
+		bool hasSoAArrays() const { return mSoAElementValueType != 0; }
+		SoAElementValueType *soaElementValueType() const { return mSoAElementValueType; }
 
 		llvm::StructType *structType() const { return mStructType; }
 	protected:
@@ -58,6 +85,7 @@ class StructValueType : public ValueType {
 		llvm::StructType *mStructType;
 		QList<StructField> mFields;
 		QMap<QString, QList<StructField>::ConstIterator> mFieldSearch;
+		SoAElementValueType *mSoAElementValueType;
 };
 
 #endif // CLASSVALUETYPE_H
@@ -225,6 +225,19 @@ void SymbolCollector::visit(ast::Expression *c) {
 
 }
 
+void SymbolCollector::visit(ast::KeywordFunctionCall *c) {
+	if (c->keyword() != ast::KeywordFunctionCall::SortType || c->parameters()->type() != ast::Node::ntList) {
+		c->parameters()->accept(this);
+		return;
+	}
+
+	// The second parameter of SortType is a name of a field
+	int index = 0;
+	for (ast::ChildNodeIterator i = c->parameters()->childNodesBegin(); i != c->parameters()->childNodesEnd(); i++, index++) {
+		if (index != 1) (*i)->accept(this);
+	}
+}
+
 bool SymbolCollector::createStructDefinition(ast::Identifier *id) {
 	if (mGlobalScope->contains(id->name())) {
 		symbolAlreadyDefinedError(id->codePoint(), mGlobalScope->find(id->name()));
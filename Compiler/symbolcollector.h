@@ -37,6 +37,7 @@ class SymbolCollector : public QObject, protected ast::Visitor {
 		void visit(ast::Identifier *c);
 
 		void visit(ast::Expression *c);
+		void visit(ast::KeywordFunctionCall *c);
 
 		bool createStructDefinition(ast::Identifier *id);
 		bool createTypeDefinition(ast::Identifier *id);
@@ -100,7 +100,10 @@ static const char *const tokenNames[] = {
 	"kLast",
 	"kBefore",
 	"kAfter",
-	"kArraySize"
+	"kArraySize",
+	"kConvertToInteger",
+	"kConvertToType",
+	"kSortType",
 
 	"KeywordsEnd",
 	"TypeCount"
@@ -102,6 +102,9 @@ class Token {
 			kBefore,
 			kAfter,
 			kArraySize,
+			kConvertToInteger,
+			kConvertToType,
+			kSortType,
 
 			KeywordsEnd,
 			TypeCount
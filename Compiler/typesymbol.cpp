@@ -4,6 +4,7 @@
 #include "runtime.h"
 #include "builder.h"
 #include "typevaluetype.h"
+#include "fieldlayoutoptimizer.h"
 
 
 TypeSymbol::TypeSymbol(const QString &name, Runtime *r, const CodePoint &cp):
@@ -43,8 +44,9 @@ ValueType *TypeSymbol::valueType() const {
 	return typePointerValueType();
 }
 
-void TypeSymbol::initializeType(Builder *b) {
-	b->irBuilder().CreateCall2(mRuntime->typeValueType()->constructTypeFunction(), mGlobalTypeVariable, b->llvmValue(mMemberSize));
+void TypeSymbol::initializeType(Builder *b, bool contiguousStorage) {
+	llvm::Function *constructFunction = contiguousStorage ? mRuntime->typeValueType()->constructContiguousTypeFunction() : mRuntime->typeValueType()->constructTypeFunction();
+	b->irBuilder().CreateCall2(constructFunction, mGlobalTypeVariable, b->llvmValue(mMemberSize));
 }
 
 void TypeSymbol::createOpaqueTypes(Builder *b) {
@@ -64,9 +66,9 @@ QString TypeField::info() const {
 }
 
 
-void TypeSymbol::createTypePointerValueType(Builder *b) {
+void TypeSymbol::createTypePointerValueType(Builder *b, const FieldLayoutOptimizer *layoutOptimizer) {
 	mRuntime = b->runtime();
-	createLLVMMemberType();
+	createLLVMMemberType(layoutOptimizer);
 	mGlobalTypeVariable = b->createGlobalVariable(mRuntime->typeLLVMType(), false, llvm::GlobalValue::InternalLinkage, llvm::Constant::getNullValue(mRuntime->typeLLVMType()));
 }
 
@@ -74,8 +76,9 @@ Value TypeSymbol::typeValue() {
 	return Value(mRuntime->typeValueType(), mGlobalTypeVariable, false);
 }
 
-void TypeSymbol::createLLVMMemberType() {
+void TypeSymbol::createLLVMMemberType(const FieldLayoutOptimizer *layoutOptimizer) {
 	assert(mMemberType);
+	if (layoutOptimizer) optimizeFieldLayout(layoutOptimizer, mRuntime->typeMemberLLVMType());
 
 	std::vector<llvm::Type*> elements;
 
@@ -94,6 +97,27 @@ void TypeSymbol::createLLVMMemberType() {
 
 }
 
+// Reorders mFields. fieldIndex() follows the new order, so the rest of the compiler doesn't notice the change.
+void TypeSymbol::optimizeFieldLayout(const FieldLayoutOptimizer *layoutOptimizer, llvm::Type *headerType) {
+	const llvm::StructLayout *headerLayout = mRuntime->dataLayout().getStructLayout(llvm::cast<llvm::StructType>(headerType));
+	unsigned lastHeaderElement = headerType->getStructNumElements() - 1;
+	uint64_t headerEnd = headerLayout->getElementOffset(lastHeaderElement) + mRuntime->dataLayout().getTypeAllocSize(headerType->getStructElementType(lastHeaderElement));
+
+	QList<QString> names;
+	QList<llvm::Type*> types;
+	foreach(const TypeField &field, mFields) {
+		names.append(field.name());
+		types.append(field.valueType()->llvmType());
+	}
+
+	QList<TypeField> fields;
+	mFieldSearch.clear();
+	foreach(int i, layoutOptimizer->layout(mName, names, types, headerEnd)) {
+		fields.append(mFields.at(i));
+		mFieldSearch.insert(mFields.at(i).name(), fields.size() - 1);
+	}
+	mFields = fields;
+}
 
 QString TypeSymbol::info() const {
 	QString str("Type %1   |   Size: %2 bytes\n");
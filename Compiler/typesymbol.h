@@ -14,6 +14,7 @@ namespace llvm{
 	class GlobalVariable;
 }
 class Builder;
+class FieldLayoutOptimizer;
 class TypePointerValueType;
 class ValueType;
 class Runtime;
@@ -45,15 +46,24 @@ class TypeSymbol : public ValueTypeSymbol {
 		llvm::StructType *llvmMemberType() const {return mMemberType;}
 		ValueType *valueType() const;
 
-		void initializeType(Builder *b);
+		/**
+		 * @brief initializeType Generates the construction of the global CB_Type.
+		 * @param contiguousStorage If true, the members are stored contiguously in the list order.
+		 */
+		void initializeType(Builder *b, bool contiguousStorage);
 		void createOpaqueTypes(Builder *b);
-		void createTypePointerValueType(Builder *b);
+		/**
+		 * @brief createTypePointerValueType Generates the member type and the global CB_Type.
+		 * @param layoutOptimizer If not null, the fields are reordered as it suggests.
+		 */
+		void createTypePointerValueType(Builder *b, const FieldLayoutOptimizer *layoutOptimizer = 0);
 		TypePointerValueType *typePointerValueType()const{return mTypePointerValueType;}
 		llvm::GlobalVariable *globalTypeVariable() { return mGlobalTypeVariable; }
 
 		Value typeValue();
 	private:
-		void createLLVMMemberType();
+		void createLLVMMemberType(const FieldLayoutOptimizer *layoutOptimizer);
+		void optimizeFieldLayout(const FieldLayoutOptimizer *layoutOptimizer, llvm::Type *headerType);
 		QList<TypeField> mFields;
 		QMap<QString, int> mFieldSearch;
 		Runtime *mRuntime;
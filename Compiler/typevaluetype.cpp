@@ -5,11 +5,15 @@
 TypeValueType::TypeValueType(Runtime *r, llvm::Type *type) :
 	ValueType(r),
 	mConstructTypeFunction(0),
+	mConstructContiguousTypeFunction(0),
 	mNewFunction(0),
 	mFirstFunction(0),
 	mLastFunction(0),
 	mBeforeFunction(0),
-	mAfterFunction(0) {
+	mAfterFunction(0),
+	mHandleFunction(0),
+	mFromHandleFunction(0),
+	mSortFunction(0) {
 	mType = type;
 }
 
@@ -33,20 +37,29 @@ int TypeValueType::size() const {
 }
 
 bool TypeValueType::isValid() {
-	return mConstructTypeFunction && mNewFunction && mFirstFunction && mLastFunction && mBeforeFunction && mAfterFunction;
+	return mConstructTypeFunction && mConstructContiguousTypeFunction && mNewFunction && mFirstFunction && mLastFunction && mBeforeFunction && mAfterFunction && mHandleFunction && mFromHandleFunction && mSortFunction;
 }
 
 bool TypeValueType::setConstructTypeFunction(llvm::Function *func) {
+	if (!isValidConstructTypeFunction(func)) return false;
+	mConstructTypeFunction = func;
+	return true;
+}
+
+bool TypeValueType::setConstructContiguousTypeFunction(llvm::Function *func) {
+	if (!isValidConstructTypeFunction(func)) return false;
+	mConstructContiguousTypeFunction = func;
+	return true;
+}
+
+bool TypeValueType::isValidConstructTypeFunction(llvm::Function *func) const {
 	if (func->arg_size() != 2) return false;
 	llvm::Function::arg_iterator i = func->arg_begin();
 	if (i->getType() != mRuntime->typeLLVMType()->getPointerTo()) return false;
 	i++;
 	if (i->getType() != llvm::Type::getInt32Ty(mRuntime->module()->getContext())) return false;
 
-	if (func->getReturnType() != llvm::Type::getVoidTy(mRuntime->module()->getContext())) return false;
-
-	mConstructTypeFunction = func;
-	return true;
+	return func->getReturnType() == llvm::Type::getVoidTy(mRuntime->module()->getContext());
 }
 
 bool TypeValueType::setNewFunction(llvm::Function *func) {
@@ -94,3 +107,34 @@ bool TypeValueType::setAfterFunction(llvm::Function *func) {
 	return true;
 }
 
+bool TypeValueType::setHandleFunction(llvm::Function *func) {
+	if (func->arg_size() != 1) return false;
+	llvm::Function::arg_iterator i = func->arg_begin();
+	if (i->getType() != mRuntime->typeMemberPointerLLVMType()) return false;
+	if (func->getReturnType() != llvm::Type::getInt32Ty(mRuntime->module()->getContext())) return false;
+	mHandleFunction = func;
+	return true;
+}
+
+bool TypeValueType::setFromHandleFunction(llvm::Function *func) {
+	if (func->arg_size() != 2) return false;
+	llvm::Function::arg_iterator i = func->arg_begin();
+	if (i->getType() != mRuntime->typeLLVMType()->getPointerTo()) return false;
+	i++;
+	if (i->getType() != llvm::Type::getInt32Ty(mRuntime->module()->getContext())) return false;
+	if (func->getReturnType() != mRuntime->typeMemberPointerLLVMType()) return false;
+	mFromHandleFunction = func;
+	return true;
+}
+
+bool TypeValueType::setSortFunction(llvm::Function *func) {
+	if (func->arg_size() != 4) return false;
+	llvm::Function::arg_iterator i = func->arg_begin();
+	if (i->getType() != mRuntime->typeLLVMType()->getPointerTo()) return false;
+	for (i++; i != func->arg_end(); i++) {
+		if (i->getType() != llvm::Type::getInt32Ty(mRuntime->module()->getContext())) return false;
+	}
+	if (func->getReturnType() != llvm::Type::getVoidTy(mRuntime->module()->getContext())) return false;
+	mSortFunction = func;
+	return true;
+}
@@ -4,6 +4,18 @@
 
 class TypeValueType : public ValueType {
 	public:
+		/**
+		 * @brief The SortKeyType enum tells CB_SortType the type of the field to compare.
+		 * Has to match CB_Type::SortKeyType of the runtime.
+		 */
+		enum SortKeyType {
+			skInteger = 0,
+			skFloat,
+			skString,
+			skShort,
+			skByte
+		};
+
 		TypeValueType(Runtime *r, llvm::Type *type);
 		QString name() const { return QObject::tr("Type"); }
 		llvm::Type *llvmType() { return mType; }
@@ -13,29 +25,42 @@ class TypeValueType : public ValueType {
 		Value cast(Builder *, const Value &v) const;
 		llvm::Constant *defaultValue() const;
 		bool setConstructTypeFunction(llvm::Function * func);
+		bool setConstructContiguousTypeFunction(llvm::Function * func);
 		bool setNewFunction(llvm::Function *func);
 		bool setFirstFunction(llvm::Function *func);
 		bool setLastFunction(llvm::Function *func);
 		bool setBeforeFunction(llvm::Function *func);
 		bool setAfterFunction(llvm::Function *func);
+		bool setHandleFunction(llvm::Function *func);
+		bool setFromHandleFunction(llvm::Function *func);
+		bool setSortFunction(llvm::Function *func);
 		llvm::Function *constructTypeFunction() const { return mConstructTypeFunction; }
+		llvm::Function *constructContiguousTypeFunction() const { return mConstructContiguousTypeFunction; }
 		llvm::Function *newFunction() const { return mNewFunction; }
 		llvm::Function *firstFunction() const { return mFirstFunction; }
 		llvm::Function *lastFunction() const { return mLastFunction; }
 		llvm::Function *beforeFunction() const { return mBeforeFunction; }
 		llvm::Function *afterFunction() const { return mAfterFunction; }
+		llvm::Function *handleFunction() const { return mHandleFunction; }
+		llvm::Function *fromHandleFunction() const { return mFromHandleFunction; }
+		llvm::Function *sortFunction() const { return mSortFunction; }
 		bool isTypePointer() const{return false;}
 		bool isNumber() const{return false;}
 		int size() const;
 		bool isValid();
 		bool isNamedValueType() const { return true; }
 	private:
+		bool isValidConstructTypeFunction(llvm::Function *func) const;
 	llvm::Function *mConstructTypeFunction;
+	llvm::Function *mConstructContiguousTypeFunction;
 	llvm::Function *mNewFunction;
 	llvm::Function *mFirstFunction;
 	llvm::Function *mLastFunction;
 	llvm::Function *mBeforeFunction;
 	llvm::Function *mAfterFunction;
+	llvm::Function *mHandleFunction;
+	llvm::Function *mFromHandleFunction;
+	llvm::Function *mSortFunction;
 };
 
 #endif // TYPEVALUETYPE_H
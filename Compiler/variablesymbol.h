@@ -3,6 +3,7 @@
 #include <QString>
 #include "codepoint.h"
 #include "symbol.h"
+#include <QList>
 class ValueType;
 namespace llvm {
 	class Value;
@@ -16,9 +17,17 @@ class VariableSymbol : public Symbol{
 		void setAlloca(llvm::Value *alloc);
 		llvm::Value *alloca_()const {return mAlloca;}
 		ValueType *valueType()const{return mValueType;}
+
+		/**
+		 * @brief constantDimensions Returns the sizes of the array, if it's always dimensioned with the same constant sizes.
+		 * Otherwise returns an empty list.
+		 */
+		const QList<int> &constantDimensions() const { return mConstantDimensions; }
+		void setConstantDimensions(const QList<int> &dims) { mConstantDimensions = dims; }
 	private:
 		ValueType *mValueType;
 		llvm::Value *mAlloca;
+		QList<int> mConstantDimensions;
 };
 
 #endif // VARIABLESYMBOL_H
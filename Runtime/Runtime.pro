@@ -27,6 +27,10 @@ SOURCES += \
     cb_types.cpp \
     types.cpp \
     lstring.cpp \
+    stringsearch.cpp \
+    numberconversion.cpp \
+    utfconversion.cpp \
+    stringtransform.cpp \
     image.cpp \
     cb_image.cpp \
     inputinterface.cpp \
@@ -38,6 +42,7 @@ SOURCES += \
     fileinterface.cpp \
     cb_struct.cpp \
     memblock.cpp \
+    stringbuilder.cpp \
     cb_mem.cpp
 
 HEADERS += \
@@ -52,13 +57,18 @@ HEADERS += \
     systeminterface.h \
     types.h \
     lstring.h \
+    stringsearch.h \
+    numberconversion.h \
+    utfconversion.h \
+    stringtransform.h \
     image.h \
     inputinterface.h \
     cbarray.h \
     atomicint.h \
     fileinterface.h \
     cb_struct.h \
-    memblock.h
+    memblock.h \
+    stringbuilder.h
 
 #win32 {
 #    LLVM_FILES += atomic_operations_mingw.ll
@@ -1,5 +1,6 @@
 #include "lstring.h"
 #include "error.h"
+#include "stringbuilder.h"
 #include <algorithm>
 #include <iomanip>
 
@@ -18,10 +19,7 @@
 }
 
 CBString CBF_chr(int c) {
-	char32_t cc[2];
-	cc[0] = c;
-	cc[1] = c;
-	return LString(cc);
+	return LString::character(c);
 }
 
  CBString CBF_left(CBString cbstr, int chars) {
@@ -52,6 +50,20 @@ CBString CBF_chr(int c) {
 	return str.right(chars);
 }
 
+ CBString CBF_mid(CBString cbstr, int start, int chars) {
+	LString str(cbstr);
+	if (start <= 0 || start > (int)str.length()) {
+		error(U"Mid: Start position must be inside the string");
+		return 0;
+	}
+	if (chars < 0) {
+		error(U"Mid: Positive number required");
+		return 0;
+	}
+	chars = std::min(chars, (int)str.length() - (start - 1));
+	return str.substr(start - 1, chars);
+}
+
  int CBF_inStr(CBString cbstr, CBString find) {
 	int index = LString(cbstr).indexOf(find);
 	if (index == -1) return -1;
@@ -91,7 +103,15 @@ int CBF_len(CBString cbstr) {
 
  CBEXPORT CBString CB_StringConstruct(char32_t *txt) {
 	if (txt) {
-		return reinterpret_cast<CBString>(LStringData::createFromBuffer(txt));
+		size_t len = 0;
+		while (txt[len]) {
+			len++;
+		}
+		// Literals which fit in Latin-1 are copied to the compact form, others are used in place.
+		if (LStringData::requiredCharSize(txt, len) == LStringData::Latin1) {
+			return reinterpret_cast<CBString>(LStringData::create(txt, len));
+		}
+		return reinterpret_cast<CBString>(LStringData::createFromBuffer(txt, len, len + 1));
 	}
 	return 0;
 }
@@ -137,7 +157,48 @@ CBEXPORT CBString CB_IntToString(int i) {
 }
 
 CBEXPORT bool CB_StringEquality(CBString a, CBString b) {
-	return LString(a) == LString(b);
+	return LStringData::equals(a, b);
 }
 
+CBEXPORT int CB_StringHash(CBString s) {
+	if (!s) return (int)LString().hash();
+	return (int)s->hash();
+}
+
+
+
+StringBuilder *CBF_makeStringBuilder() {
+	return new StringBuilder();
+}
+
+void CBF_deleteStringBuilder(StringBuilder *builder) {
+	delete builder;
+}
 
+void CBF_stringBuilderAppend(StringBuilder *builder, CBString str) {
+	builder->append(LString(str));
+}
+
+void CBF_stringBuilderAppend(StringBuilder *builder, int i) {
+	builder->append(LString::number(i));
+}
+
+void CBF_stringBuilderAppend(StringBuilder *builder, float f) {
+	builder->append(LString::number(f));
+}
+
+void CBF_stringBuilderAppendChar(StringBuilder *builder, int c) {
+	builder->append(LChar(c));
+}
+
+int CBF_stringBuilderLength(StringBuilder *builder) {
+	return (int)builder->length();
+}
+
+CBString CBF_stringBuilderToString(StringBuilder *builder) {
+	return builder->toString();
+}
+
+void CBF_stringBuilderClear(StringBuilder *builder) {
+	builder->clear();
+}
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 #include <iostream>
 #include <locale>
@@ -15,6 +16,17 @@ CBEXPORT void CB_Free(char *mem) {
 	delete [] mem;
 }
 
+//Called by the code generated for Gosub and Return. Don't return.
+CBEXPORT void CB_GosubStackOverflow() {
+	error(LString(U"Too many nested Gosubs"));
+	exit(1);
+}
+
+CBEXPORT void CB_ReturnWithoutGosub() {
+	error(LString(U"Return without Gosub"));
+	exit(1);
+}
+
 int CBF_int(float f) {
 	return int(f + 0.5f);
 }
@@ -4,9 +4,11 @@
 
 
 extern "C" void CB_ConstructType(CB_Type *type, unsigned int size) {
-	type->setFirstMember(0);
-	type->setLastMember(0);
-	type->setSizeOfMember(size);
+	type->construct(size, false);
+}
+
+extern "C" void CB_ConstructContiguousType(CB_Type *type, unsigned int size) {
+	type->construct(size, true);
 }
 
 CBEXPORT TypeMember *CB_New(Type *type) {
@@ -21,6 +23,19 @@ CBEXPORT TypeMember *CB_Last(Type *type) {
 	return type->lastMember();
 }
 
+CBEXPORT int CB_TypeMemberHandle(TypeMember *member) {
+	if (member == 0) return 0;
+	return member->type()->handle(member);
+}
+
+CBEXPORT TypeMember *CB_TypeMemberFromHandle(Type *type, int handle) {
+	return type->memberByHandle(handle);
+}
+
+CBEXPORT void CB_SortType(Type *type, int fieldOffset, int keyType, int descending) {
+	type->sort(fieldOffset, static_cast<Type::SortKeyType>(keyType), descending != 0);
+}
+
 CBEXPORT TypeMember *CB_After(TypeMember *member) {
 	if (member == 0) {
 		error(U"CBF_CB_TypeMemberAfter: Invalid TypeMember");
@@ -5,6 +5,8 @@
 #include <cstring>
 #include "common.h"
 #include <cstdio>
+#include <cstdlib>
+#include "error.h"
 
 CBEXPORT CB_GenericArrayDataHeader *CB_ArrayConstruct(ArraySizeType dimCount, ArraySizeType *arrSizes, ArraySizeType dataTypeSize) {
 	ArraySizeType elements = 1;
@@ -48,6 +50,14 @@ CBEXPORT void CB_ArrayAssign(CB_GenericArrayDataHeader **target, CB_GenericArray
 	*target = source;
 }
 
+//Called by the bounds checking code generated by the compiler. Doesn't return.
+CBEXPORT void CB_ArrayIndexOutOfBounds(ArraySizeType dimension, ArraySizeType index, ArraySizeType size) {
+	error(LString(U"Array index ") + LString::number((int)index) +
+		  LString(U" out of bounds in dimension ") + LString::number((int)dimension + 1) +
+		  LString(U" of size ") + LString::number((int)size));
+	exit(1);
+}
+
 
 
 
@@ -126,12 +126,13 @@ void writeString(File *f, const LString &s) {
 	int l = int(s.length());
 
 	al_fwrite(f, &l, sizeof(int));
-	al_fwrite(f, s.begin(), sizeof(char32_t));
+	std::u32string chars = s.toU32String();
+	al_fwrite(f, chars.data(), l * sizeof(char32_t));
 }
 
 void writeLine(File *f, const LString &s) {
 	const std::string &line = s.toUtf8();
-	al_fputs(f, line.c_str());
+	al_fwrite(f, line.data(), line.size());
 	#ifdef WIN32
 		al_fputs(f, "\r\n");
 	#else
@@ -312,11 +313,11 @@ LString readString(File *f) {
 	int32_t l;
 	al_fread(f, &l, sizeof(int32_t));
 
-	LString str;
-	str.resize(l);
-	al_fread(f, str.begin(), sizeof(char32_t));
+	if (l <= 0) return LString();
+	std::u32string chars(l, 0);
+	al_fread(f, &chars[0], l * sizeof(char32_t));
 
-	return str;
+	return LString(chars.data(), l);
 }
 
 LString readLine(File *f) {
@@ -47,10 +47,9 @@ void gfx::drawCircle(float x, float y, float d, bool fill) {
 
 void gfx::drawText(const LString &str, float x, float y) {
 	assert(RenderTarget::activated());
-	ALLEGRO_USTR *ustr = str.toAllegroUStr();
+	const ALLEGRO_USTR *ustr = str.toAllegroUStr();
 	if (ustr) {
 		al_draw_ustr(text::currentFont(), sCurrentColor, x, y, 0, ustr);
-		al_ustr_free(ustr);
 	}
 }
 
@@ -2,26 +2,211 @@
 #include <stddef.h>
 #include <string.h>
 #include <algorithm>
+#include <vector>
 #include <stdio.h>
 #include <locale>
 #include "error.h"
+#include "stringsearch.h"
+#include "numberconversion.h"
+#include "utfconversion.h"
+#include "stringtransform.h"
 
 std::string LString::sNullStdString;
 
+// The range of integers whose decimal representation is preallocated
+#ifndef CB_IMMORTAL_INT_STRING_MIN
+	#define CB_IMMORTAL_INT_STRING_MIN -128
+#endif
+#ifndef CB_IMMORTAL_INT_STRING_MAX
+	#define CB_IMMORTAL_INT_STRING_MAX 1023
+#endif
+
+// Shorter substrings are copied, because a view isn't smaller than the characters.
+static const size_t minViewLength = 32;
+
+namespace {
+
+template <typename Dest, typename Src>
+void copyChars(Dest *dest, const Src *src, size_t len) {
+	for (size_t i = 0; i < len; ++i) {
+		dest[i] = static_cast<Dest>(src[i]);
+	}
+}
+
+void copyChars(uint8_t *dest, const uint8_t *src, size_t len) {
+	memcpy(dest, src, len);
+}
+
+void copyChars(LChar *dest, const LChar *src, size_t len) {
+	memcpy(dest, src, len * sizeof(LChar));
+}
+
+/**
+ * Copies characters between two buffers of any width. Copying to a Latin-1 buffer
+ * requires that the copied characters are representable in Latin-1.
+ */
+void copyData(LStringData *dest, size_t destIndex, const LStringData *src, size_t srcIndex, size_t len) {
+	if (dest->isLatin1()) {
+		if (src->isLatin1()) {
+			copyChars(dest->latin1() + destIndex, src->latin1() + srcIndex, len);
+		}
+		else {
+			copyChars(dest->latin1() + destIndex, src->utf32() + srcIndex, len);
+		}
+	}
+	else {
+		if (src->isLatin1()) {
+			copyChars(dest->utf32() + destIndex, src->latin1() + srcIndex, len);
+		}
+		else {
+			copyChars(dest->utf32() + destIndex, src->utf32() + srcIndex, len);
+		}
+	}
+}
+
+template <typename A, typename B>
+int compareChars(const A *a, size_t aLen, const B *b, size_t bLen) {
+	size_t len = std::min(aLen, bLen);
+	for (size_t i = 0; i < len; ++i) {
+		if (LChar(a[i]) != LChar(b[i])) return LChar(a[i]) < LChar(b[i]) ? -1 : 1;
+	}
+	if (aLen == bLen) return 0;
+	return aLen < bLen ? -1 : 1;
+}
+
+int compareChars(const uint8_t *a, size_t aLen, const uint8_t *b, size_t bLen) {
+	int r = memcmp(a, b, std::min(aLen, bLen));
+	if (r != 0) return r < 0 ? -1 : 1;
+	if (aLen == bLen) return 0;
+	return aLen < bLen ? -1 : 1;
+}
+
+// Searches a UTF-32 haystack for a Latin-1 needle by widening the needle
+int indexOfLatin1(const char32_t *haystack, size_t haystackLen, const uint8_t *needle, size_t needleLen, size_t start) {
+	std::vector<char32_t> wide(needle, needle + needleLen);
+	return stringsearch::find(haystack, haystackLen, wide.data(), needleLen, start);
+}
+
+// Searches a Latin-1 haystack for a UTF-32 needle. The needle can match only if all of its characters fit to Latin-1.
+int indexOfUtf32(const uint8_t *haystack, size_t haystackLen, const char32_t *needle, size_t needleLen, size_t start) {
+	std::vector<uint8_t> narrow(needleLen);
+	for (size_t i = 0; i < needleLen; ++i) {
+		if (needle[i] > 0xFF) return -1;
+		narrow[i] = static_cast<uint8_t>(needle[i]);
+	}
+	return stringsearch::find(haystack, haystackLen, narrow.data(), needleLen, start);
+}
+
+template <typename T>
+uint32_t hashChars(const T *chars, size_t len) {
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < len; ++i) {
+		h ^= (uint32_t)chars[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+LStringData *unsignedToStringData(unsigned int i, unsigned int base, bool negative) {
+	static const char nums[] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+	uint8_t buffer[34];
+	uint8_t *str = buffer + sizeof(buffer);
+	do {
+		*(--str) = nums[i % base];
+		i /= base;
+	} while (i);
+	if (negative) *(--str) = '-';
+	return LStringData::create(str, buffer + sizeof(buffer) - str);
+}
+
+LStringData *intToStringData(int i, unsigned int base) {
+	if (i < 0) return unsignedToStringData(0u - (unsigned int)i, base, true);
+	return unsignedToStringData(i, base, false);
+}
+
+/**
+ * Strings of single Latin-1 characters and small integers, which are used constantly
+ * when processing text character by character and when printing numbers.
+ */
+class ImmortalStrings {
+	public:
+		static const ImmortalStrings &instance() {
+			static ImmortalStrings strings;
+			return strings;
+		}
+
+		LStringData *character(LChar c) const {
+			return c < 256 ? mCharacters[c] : 0;
+		}
+
+		LStringData *integer(int i) const {
+			if (i < CB_IMMORTAL_INT_STRING_MIN || i > CB_IMMORTAL_INT_STRING_MAX) return 0;
+			return mIntegers[i - CB_IMMORTAL_INT_STRING_MIN];
+		}
+	private:
+		ImmortalStrings() {
+			for (int c = 0; c < 256; ++c) {
+				uint8_t ch = static_cast<uint8_t>(c);
+				mCharacters[c] = LStringData::create(&ch, 1);
+				mCharacters[c]->makeImmortal();
+			}
+			for (int i = CB_IMMORTAL_INT_STRING_MIN; i <= CB_IMMORTAL_INT_STRING_MAX; ++i) {
+				LStringData *d = intToStringData(i, 10);
+				d->makeImmortal();
+				mIntegers[i - CB_IMMORTAL_INT_STRING_MIN] = d;
+			}
+		}
+
+		LStringData *mCharacters[256];
+		LStringData *mIntegers[CB_IMMORTAL_INT_STRING_MAX - CB_IMMORTAL_INT_STRING_MIN + 1];
+};
+
+LStringData *createFromRange(LString::ConstIterator begin, LString::ConstIterator end) {
+	size_t len = end - begin;
+	// The null string is the empty string, and single characters are shared
+	if (len == 0) return 0;
+	if (len == 1) {
+		LStringData *d = ImmortalStrings::instance().character(*begin);
+		if (d) return d;
+	}
+	if (begin.charSize() == LStringData::Latin1) {
+		return LStringData::create(reinterpret_cast<const uint8_t*>(begin.data()), len);
+	}
+	return LStringData::create(reinterpret_cast<const LChar*>(begin.data()), len);
+}
+
+LStringData *createSubstring(LStringData *parent, size_t start, size_t len) {
+	if (len == parent->mSize) {
+		parent->increase();
+		return parent;
+	}
+	if (len < minViewLength) {
+		LString::ConstIterator begin(parent->data(), parent->mCharSize);
+		begin += start;
+		return createFromRange(begin, begin + len);
+	}
+	return LStringData::createView(parent, start, len);
+}
+
+}
+
 
 //LStringData
 //-------------------------------------------------------------------------
 
 
-LStringData *LStringData::create(size_t size) {
+LStringData *LStringData::create(size_t size, CharSize charSize) {
 	assert(size > 0);
-	char *buffer = new char[sizeof(LStringData) + size * sizeof(LChar)];
+	char *buffer = new char[sizeof(LStringData) + size * charSize];
 	LStringData *ret = reinterpret_cast<LStringData*>(buffer);
 	ret->mRefCount = 1;
 	ret->mSize = 0;
 	ret->mCapacity = size;
-	ret->mUtf8String = 0;
+	ret->mUtf8Cache = 0;
 	ret->mOffset = sizeof(LStringData);
+	ret->mCharSize = charSize;
+	ret->mParent = 0;
+	ret->mHash = 0;
 	return ret;
 }
 
@@ -30,18 +215,29 @@ LStringData *LStringData::create(const LChar *text) {
 	while(text[len]) {
 		len++;
 	}
+	return create(text, len);
+}
 
-	LStringData *d = create(len + 1);
+LStringData *LStringData::create(const LChar *text, size_t len) {
+	CharSize charSize = requiredCharSize(text, len);
+	LStringData *d = create(len + 1, charSize);
 	d->mSize = len;
-	memcpy(d->begin(), text, (len + 1) * sizeof(LChar));
+	if (charSize == Latin1) {
+		copyChars(d->latin1(), text, len);
+		d->latin1()[len] = 0; //null
+	}
+	else {
+		copyChars(d->utf32(), text, len);
+		d->utf32()[len] = 0; //null
+	}
 	return d;
 }
 
-LStringData *LStringData::create(const LChar *text, size_t len) {
-	LStringData *d = create(len + 1);
+LStringData *LStringData::create(const uint8_t *latin1, size_t len) {
+	LStringData *d = create(len + 1, Latin1);
 	d->mSize = len;
-	memcpy(d->begin(), text, len * sizeof(LChar));
-	d->begin()[len] = 0; //null
+	copyChars(d->latin1(), latin1, len);
+	d->latin1()[len] = 0; //null
 	return d;
 }
 
@@ -58,39 +254,71 @@ LStringData *LStringData::createFromBuffer(LChar *buffer, size_t stringLength, s
 	LStringData *ret = reinterpret_cast<LStringData*>(buf);
 	ret->mSize = stringLength;
 	ret->mCapacity = bufferSize;
-	ret->mUtf8String = 0;
+	ret->mUtf8Cache = 0;
 	ret->mRefCount = 1;
 	ret->mOffset = reinterpret_cast<char*>(buffer) - buf;
+	ret->mCharSize = Utf32;
+	ret->mParent = 0;
+	ret->mHash = 0;
 	return ret;
 }
 
-LStringData *LStringData::copy(LStringData *o) {
-	if (o->isStaticData()) {
-		char *buffer = new char[sizeof(LStringData)];
-		LStringData *ret = reinterpret_cast<LStringData*>(buffer);
-		memcpy(o, ret, sizeof(LStringData));
-		ret->mUtf8String = 0;
-		ret->mRefCount = 1;
-		return ret;
-	}
-	char *buffer = new char[sizeof(LStringData) + o->mCapacity * sizeof(LChar)];
-	LStringData *ret = reinterpret_cast<LStringData*>(buffer);
-	memcpy(ret, o, sizeof(LStringData) + o->mCapacity * sizeof(LChar));
-	ret->mUtf8String = 0;
+/**
+ * @brief LStringData::createView Creates a string which shares len characters of the parent starting from start.
+ * The view keeps the parent alive and is copied before modifying like static data.
+ */
+LStringData *LStringData::createView(LStringData *parent, size_t start, size_t len) {
+	assert(start + len <= parent->mSize);
+	char *buf = new char[sizeof(LStringData)];
+	LStringData *ret = reinterpret_cast<LStringData*>(buf);
+	ret->mSize = len;
+	ret->mCapacity = len;
+	ret->mUtf8Cache = 0;
 	ret->mRefCount = 1;
+	ret->mOffset = (parent->data() + start * parent->mCharSize) - buf;
+	ret->mCharSize = parent->mCharSize;
+
+	// A view of a view refers directly to the string owning the characters
+	ret->mParent = parent->isView() ? parent->mParent : parent;
+	ret->mParent->increase();
+	ret->mHash = 0;
+	return ret;
+}
+
+LStringData *LStringData::copy(LStringData *o) {
+	return copy(o, std::max(o->mCapacity, o->mSize + 1), o->mCharSize);
+}
+
+LStringData *LStringData::copy(LStringData *o, size_t capacity, CharSize charSize) {
+	assert(capacity > o->mSize);
+	LStringData *ret = create(capacity, charSize);
+	ret->mSize = o->mSize;
+	ret->mHash = o->mHash;
+	copyData(ret, 0, o, 0, o->mSize);
 	return ret;
 }
 
 void LStringData::destruct(LStringData *d) {
-	if (d->mUtf8String) delete d->mUtf8String;
+	d->clearUtf8Cache();
+	LStringData *parent = d->mParent;
 	delete [] reinterpret_cast<char*>(d);
+	if (parent) parent->decrease();
+}
+
+LStringData::CharSize LStringData::requiredCharSize(const LChar *text, size_t len) {
+	for (size_t i = 0; i < len; ++i) {
+		if (text[i] > 0xFF) return Utf32;
+	}
+	return Latin1;
 }
 
 void LStringData::increase() {
+	if (isImmortal()) return;
 	atomicIncrease(mRefCount);
 }
 
 bool LStringData::decrease() {
+	if (isImmortal()) return false;
 	if (atomicDecrease(mRefCount)) {
 		atomicThreadFenceAcquire();
 		LStringData::destruct(this);
@@ -100,24 +328,49 @@ bool LStringData::decrease() {
 }
 
 
-bool LStringData::isStaticData() const {
-	return mOffset != sizeof(LStringData);
+/**
+ * @brief LStringData::hash Returns the hash of the characters. It's calculated on the first call and cached.
+ */
+uint32_t LStringData::hash() const {
+	if (mHash) return mHash;
+	uint32_t h = isLatin1() ? hashChars(latin1(), mSize) : hashChars(utf32(), mSize);
+	mHash = h;
+	return h;
 }
 
-LChar *LStringData::begin() {
-	return reinterpret_cast<LChar*>(reinterpret_cast<char*>(this) + this->mOffset);
+/**
+ * @brief LStringData::equals Compares the characters of two strings, either of which can be null.
+ * Avoids the comparison when the strings are the same, have different lengths or different cached hashes.
+ */
+bool LStringData::equals(const LStringData *a, const LStringData *b) {
+	if (a == b) return true;
+	size_t len = a ? a->mSize : 0;
+	if (len != (b ? b->mSize : 0)) return false;
+	if (len == 0) return true;
+	if (a->mHash && b->mHash && a->mHash != b->mHash) return false;
+	if (a->mCharSize == b->mCharSize) return memcmp(a->data(), b->data(), len * a->mCharSize) == 0;
+	if (a->isLatin1()) return compareChars(a->latin1(), len, b->utf32(), len) == 0;
+	return compareChars(a->utf32(), len, b->latin1(), len) == 0;
 }
 
-LChar *LStringData::end() {
-	return reinterpret_cast<LChar*>(reinterpret_cast<char*>(this) + this->mOffset) + this->mSize;
+void LStringData::clearUtf8Cache() {
+	delete mUtf8Cache;
+	mUtf8Cache = 0;
 }
 
-const LChar *LStringData::begin() const {
-	return reinterpret_cast<const LChar*>(reinterpret_cast<const char*>(this) + this->mOffset);
+bool LStringData::isStaticData() const {
+	return mOffset != sizeof(LStringData);
 }
 
-const LChar *LStringData::end() const {
-	return reinterpret_cast<const LChar*>(reinterpret_cast<const char*>(this) + this->mOffset) + this->mSize;
+void LStringData::setCharAt(size_t i, LChar c) {
+	assert(i < mCapacity);
+	if (isLatin1()) {
+		assert(c <= 0xFF && "Character doesn't fit in a Latin-1 string");
+		latin1()[i] = static_cast<uint8_t>(c);
+	}
+	else {
+		utf32()[i] = c;
+	}
 }
 
 
@@ -131,7 +384,7 @@ LString::LString(const LChar *str) : mData(LStringData::create(str)) { }
 
 LString::LString(const LChar *str, size_t len) : mData(LStringData::create(str, len)) { }
 
-LString::LString(LString::ConstIterator begin, LString::ConstIterator end) : mData(LStringData::create(begin, (size_t)(end - begin))) { }
+LString::LString(LString::ConstIterator begin, LString::ConstIterator end) : mData(createFromRange(begin, end)) { }
 
 LString::LString(const LString &o) : mData(o.mData) { }
 
@@ -160,105 +413,55 @@ LString LString::fromUtf8(const std::string &s) {
 	if (s.size() == 0) return LString();
 	const uint8_t *begin = reinterpret_cast<const uint8_t*>(s.c_str());
 	const uint8_t *end = begin + s.size();
-	LString ret;
-	ret.reserve(s.size());
 
-	LChar *destBegin = ret.begin();
-	LChar *destEnd = ret.end();
+	// ASCII is valid Latin-1 as it is
+	if (utfconversion::asciiPrefixLength(begin, s.size()) == s.size()) return fromLatin1(begin, s.size());
+
+	std::vector<LChar> buffer(s.size());
+	LChar *destBegin = &buffer[0];
+	LChar *destEnd = destBegin + buffer.size();
 	bool conversionSucceeded = utf8ToUtf32(&begin, end, &destBegin, destEnd);
 	assert(conversionSucceeded && "Failed conversion utf8 -> utf32");
 
-	ret.resize(destBegin - ret.begin());
-	return ret;
+	return LString(LStringData::create(&buffer[0], destBegin - &buffer[0]));
 }
 
 LString LString::fromAscii(const std::string &s) {
-	LString ret;
-	ret.resize(s.size());
-	LString::Iterator out = ret.begin();
-	for (std::string::const_iterator i = s.begin(); i != s.end(); ++i) {
-		*out = *i;
-	}
-	return ret;
+	return fromLatin1(reinterpret_cast<const uint8_t*>(s.c_str()), s.size());
+}
+
+LString LString::fromLatin1(const uint8_t *str, size_t len) {
+	return LString(LStringData::create(str, len));
 }
 
 LString LString::fromBuffer(LChar *buffer) {
 	return LString(LStringData::createFromBuffer(buffer));
 }
 
+LString LString::character(LChar c) {
+	LStringData *d = ImmortalStrings::instance().character(c);
+	if (d) return LString(d);
+	return LString(LStringData::create(&c, 1));
+}
+
 LString LString::number(int i, int base) {
 	assert(base >= 2 && base <= 16);
-	if (i == 0) return LString(U"0");
-	static const char32_t nums[] = {U'0', U'1', U'2', U'3', U'4', U'5', U'6', U'7', U'8', U'9', U'A', U'B', U'C', U'D', U'E', U'F'};
-	LStringData *data = LStringData::create(6 + 64 / base);
-	LChar *str = data->begin();
-	int size = 0;
-	if (i < 0) {
-		*str = U'-';
-		i = -i;
-		str++;
-		++size;
-	}
-
-	int shifter = i;
-	do{ //Move to where representation ends
-		++str;
-		shifter = shifter/base;
-	}while(shifter);
-
-	*str = 0;
-	while (i) {
-		*(--str) = nums[i % base];
-		++size;
-		i /= base;
-	}
-
-	data->mSize = size;
-	return LString(data);
-}
-
-LString LString::number(unsigned int i, int b) {
-	assert(b >= 2 && b <= 16);
-	unsigned int base = b;
-	if (i == 0) return LString(U"0");
-	static const char32_t nums[] = {U'0', U'1', U'2', U'3', U'4', U'5', U'6', U'7', U'8', U'9', U'A', U'B', U'C', U'D', U'E', U'F'};
-	LStringData *data = LStringData::create(6 + 64 / base);
-	LChar *str = data->begin();
-	int size = 0;
-	unsigned int shifter = i;
-	do{ //Move to where representation ends
-		++str;
-		shifter = shifter/base;
-	}while(shifter);
-
-	*str = 0;
-	while (i) {
-		*(--str) = nums[i % base];
-		++size;
-		i /= base;
+	if (base == 10) {
+		LStringData *d = ImmortalStrings::instance().integer(i);
+		if (d) return LString(d);
 	}
+	return LString(intToStringData(i, base));
+}
 
-	data->mSize = size;
-	return LString(data);
+LString LString::number(unsigned int i, int base) {
+	assert(base >= 2 && base <= 16);
+	return LString(unsignedToStringData(i, base, false));
 }
 
 LString LString::number(float f) {
-	const size_t bufferSize = 12;
-	LStringData *data = LStringData::create(bufferSize);
-
-#ifndef _WIN32
-	assert(sizeof(wchar_t) == sizeof(char32_t));
-	data->mSize = swprintf(reinterpret_cast<wchar_t*>(data->begin()), bufferSize, L"%g", f);
-	return LString(data);
-#else
-	char charBuf[bufferSize];
-	data->mSize = snprintf(charBuf, bufferSize, "%g", f);
-	for (size_t i = 0; i < data->mSize; ++i) {
-		data->begin()[i] = static_cast<char32_t>(charBuf[i]);
-	}
-	data->begin()[data->mSize] = 0;
-	return LString(data);
-#endif
+	char buffer[numberconversion::floatBufferSize];
+	size_t len = numberconversion::formatFloat(f, buffer);
+	return fromLatin1(reinterpret_cast<const uint8_t*>(buffer), len);
 }
 
 LString &LString::operator =(const LString &o) {
@@ -266,77 +469,58 @@ LString &LString::operator =(const LString &o) {
 	return *this;
 }
 
-bool LString::operator ==(const LString &o) const {
-	LString::ConstIterator thisI = this->cbegin();
-	LString::ConstIterator oI = o.cbegin();
-	for (;thisI != this->cend() && oI != o.cend(); thisI++, oI++) {
-		if (*thisI != *oI) return false;
+int LString::compare(const LString &o) const {
+	size_t len = length();
+	size_t oLen = o.length();
+	if (len == 0 || oLen == 0) {
+		if (len == oLen) return 0;
+		return len < oLen ? -1 : 1;
 	}
-	return true;
+	const LStringData *a = mData.unsafePointer();
+	const LStringData *b = o.mData.unsafePointer();
+	if (a->isLatin1()) {
+		if (b->isLatin1()) return compareChars(a->latin1(), len, b->latin1(), oLen);
+		return compareChars(a->latin1(), len, b->utf32(), oLen);
+	}
+	if (b->isLatin1()) return compareChars(a->utf32(), len, b->latin1(), oLen);
+	return compareChars(a->utf32(), len, b->utf32(), oLen);
+}
+
+bool LString::operator ==(const LString &o) const {
+	return LStringData::equals(mData.unsafePointer(), o.mData.unsafePointer());
 }
 
 bool LString::operator !=(const LString &o) const {
-	LString::ConstIterator thisI = this->cbegin();
-	LString::ConstIterator oI = o.cbegin();
-	for (;thisI != this->cend() && oI != o.cend(); thisI++, oI++) {
-		if (*thisI == *oI) return false;
-	}
-	return true;
+	return !(*this == o);
 }
 
 bool LString::operator >(const LString &o) const {
-	LString::ConstIterator thisI = this->cbegin();
-	LString::ConstIterator oI = o.cbegin();
-	for (;thisI != this->cend() && oI != o.cend(); thisI++, oI++) {
-		if (*thisI == *oI) continue;
-		if (*thisI > *oI) return true;
-		return false;
-	}
-	return false;
+	return compare(o) > 0;
 }
 
 bool LString::operator >=(const LString &o) const {
-	LString::ConstIterator thisI = this->cbegin();
-	LString::ConstIterator oI = o.cbegin();
-	for (;thisI != this->cend() && oI != o.cend(); thisI++, oI++) {
-		if (*thisI == *oI) continue;
-		if (*thisI > *oI) return true;
-		return false;
-	}
-	return true;
+	return compare(o) >= 0;
 }
 
 bool LString::operator <(const LString &o) const {
-	LString::ConstIterator thisI = this->cbegin();
-	LString::ConstIterator oI = o.cbegin();
-	for (;thisI != this->cend() && oI != o.cend(); thisI++, oI++) {
-		if (*thisI == *oI) continue;
-		if (*thisI < *oI) return true;
-		return false;
-	}
-	return false;
+	return compare(o) < 0;
 }
 
 bool LString::operator <=(const LString &o) const {
-	LString::ConstIterator thisI = this->cbegin();
-	LString::ConstIterator oI = o.cbegin();
-	for (;thisI != this->cend() && oI != o.cend(); thisI++, oI++) {
-		if (*thisI == *oI) continue;
-		if (*thisI < *oI) return true;
-		return false;
-	}
-	return true;
+	return compare(o) <= 0;
 }
 
 LString LString::operator +(const LString &o) const {
 	if (this->isEmpty()) return o;
 	if (o.isEmpty()) return *this;
 
-	LStringData *newStr = LStringData::create(this->length() + o.length() + 1);
-	std::copy(this->mData->begin(), this->mData->end(), newStr->begin());
-	std::copy(o.mData->begin(), o.mData->end(), newStr->begin() + this->length());
+	const LStringData *a = this->mData.unsafePointer();
+	const LStringData *b = o.mData.unsafePointer();
+	LStringData *newStr = LStringData::create(a->mSize + b->mSize + 1, std::max(a->mCharSize, b->mCharSize));
+	copyData(newStr, 0, a, 0, a->mSize);
+	copyData(newStr, a->mSize, b, 0, b->mSize);
 
-	newStr->mSize = this->length() + o.length();
+	newStr->mSize = a->mSize + b->mSize;
 	return LString(newStr);
 }
 
@@ -346,36 +530,39 @@ LString &LString::operator +=(const LString &o) {
 		*this = o;
 		return *this;
 	}
-	if (this->length() + o.length() > this->size()) {
-		size_t next = nextSize();
-		if (next < this->length() + o.length()) {
-			reserve(this->length() + o.length());
-		}
-		else {
-			reserve(next);
-		}
+	size_t len = this->length();
+	size_t oLen = o.length();
+	LStringData::CharSize charSize = o.mData.unsafePointer()->mCharSize;
+	if (len + oLen > this->capacity()) {
+		reserve(std::max(nextSize(), len + oLen), charSize);
+	}
+	else {
+		reserve(len + oLen, charSize);
 	}
-	std::copy(o.mData->begin(), o.mData->end(), this->mData->begin() + this->length());
+	LStringData *d = mutableData();
+	copyData(d, len, o.mData.unsafePointer(), 0, oLen);
+	d->mSize = len + oLen;
 	return *this;
 }
 
 LString &LString::operator +=(LChar c) {
-	if (this->length() + 1 > this->capacity()) {
-		reserve(nextSize());
+	size_t len = this->length();
+	LStringData::CharSize charSize = LStringData::requiredCharSize(c);
+	if (len + 1 > this->capacity()) {
+		reserve(std::max(nextSize(), len + 1), charSize);
 	}
-	this->mData->begin()[this->mData->mSize] = c;
-	++this->mData->mSize;
+	else {
+		reserve(len + 1, charSize);
+	}
+	LStringData *d = mutableData();
+	d->setCharAt(len, c);
+	d->mSize = len + 1;
 	return *this;
 }
 
-LChar &LString::operator [](int i) {
-	assert(i < (int)length());
-	return this->mData->begin()[i];
-}
-
-const LChar &LString::operator [](int i) const {
-	assert(i < (int)length());
-	return this->mData->begin()[i];
+LChar LString::operator [](int i) const {
+	assert(i >= 0 && i < (int)length());
+	return this->mData->charAt(i);
 }
 
 LString::operator CBString() const {
@@ -385,44 +572,37 @@ LString::operator CBString() const {
 }
 
 LString LString::substr(int start, int len) const {
-	ConstIterator b = cbegin() + start;
-	ConstIterator e = b + len;
-	assert(isValidIterator(b));
-	assert(isValidIterator(e));
-	return LString(b, e);
+	assert(start >= 0 && len >= 0 && start + len <= (int)length());
+	if (len == 0) return LString();
+	return LString(createSubstring(mData.unsafePointer(), start, len));
 }
 
 LString LString::left(int chars) const {
-	assert(isEmpty() && "String is empty. Invalid Left function call");
 	assert(chars <= (int)length() && chars > 0 && "Invalid Left function call");
-	return LString(begin(), chars);
+	return substr(0, chars);
 }
 
 LString LString::right(int chars) const {
-	assert(isEmpty() && "String is empty. Invalid Left function call");
-	assert(chars <= (int)length() && chars > 0 && "Invalid Left function call");
-	return LString(begin() + (length() - chars), (length() - chars));
+	assert(chars <= (int)length() && chars > 0 && "Invalid Right function call");
+	return substr(length() - chars, chars);
 }
 
 LString LString::trimmed() const {
-	LString::ConstIterator start = end();
-	for (LString::ConstIterator i = begin(); i != end(); i++) {
-		if (!isWhitespace(*i)) {
-			start = i;
-			break;
-		}
+	if (isEmpty()) return *this;
+	const LStringData *d = mData.unsafePointer();
+	size_t start, end;
+	if (d->isLatin1()) {
+		start = stringtransform::leadingWhitespace(d->latin1(), d->mSize);
+		end = d->mSize - (start == d->mSize ? 0 : stringtransform::trailingWhitespace(d->latin1(), d->mSize));
 	}
-	if (start == end()) return *this;
-
-	LString::ConstIterator e = end();
-	for (LString::ConstIterator i = end() - 1;i != begin(); --i) {
-		if (!isWhitespace(*i)) {
-			e = i + 1;
-			break;
-		}
+	else {
+		start = stringtransform::leadingWhitespace(d->utf32(), d->mSize);
+		end = d->mSize - (start == d->mSize ? 0 : stringtransform::trailingWhitespace(d->utf32(), d->mSize));
 	}
+	if (start == 0 && end == d->mSize) return *this;
+	if (start == end) return LString();
 
-	return LString(start, e);
+	return substr(start, end - start);
 }
 
 LString LString::rightJustified(size_t width, LChar fill, bool truncate) const {
@@ -438,29 +618,32 @@ LString LString::leftJustified(size_t width, LChar fill, bool truncate) const {
 }
 
 LString LString::toUpper() const {
-	LString ret;
-	ret.resize(size());
-	LString::Iterator out = ret.begin();
-	for (LString::ConstIterator i = begin(); i != end(); i++) {
-		char32_t ch = *i;
-		ch = toUpper(ch);
-		*out = ch;
-		++out;
+	if (isEmpty()) return *this;
+	const LStringData *d = mData.unsafePointer();
+	// Case conversion doesn't move characters out of Latin-1
+	LStringData *ret = LStringData::create(d->mSize + 1, d->mCharSize);
+	ret->mSize = d->mSize;
+	if (d->isLatin1()) {
+		stringtransform::toUpper(ret->latin1(), d->latin1(), d->mSize, &LString::toUpper);
 	}
-	return ret;
+	else {
+		stringtransform::toUpper(ret->utf32(), d->utf32(), d->mSize, &LString::toUpper);
+	}
+	return LString(ret);
 }
 
 LString LString::toLower() const {
-	LString ret;
-	ret.resize(size());
-	LString::Iterator out = ret.begin();
-	for (LString::ConstIterator i = begin(); i != end(); i++) {
-		char32_t ch = *i;
-		ch = toLower(ch);
-		*out = ch;
-		++out;
+	if (isEmpty()) return *this;
+	const LStringData *d = mData.unsafePointer();
+	LStringData *ret = LStringData::create(d->mSize + 1, d->mCharSize);
+	ret->mSize = d->mSize;
+	if (d->isLatin1()) {
+		stringtransform::toLower(ret->latin1(), d->latin1(), d->mSize, &LString::toLower);
 	}
-	return ret;
+	else {
+		stringtransform::toLower(ret->utf32(), d->utf32(), d->mSize, &LString::toLower);
+	}
+	return LString(ret);
 }
 
 void LString::rightJustify(size_t width, LChar fill, bool truncate) {
@@ -471,12 +654,12 @@ void LString::rightJustify(size_t width, LChar fill, bool truncate) {
 		return;
 	}
 	size_t oldSize = size();
-	resize(width);
-	Iterator i = begin() + oldSize;
-	Iterator e = begin() + width;
-	for (; i != e; i++) {
-		*i = fill;
+	reserve(width, LStringData::requiredCharSize(fill));
+	LStringData *d = mutableData();
+	for (size_t i = oldSize; i < width; i++) {
+		d->setCharAt(i, fill);
 	}
+	d->mSize = width;
 }
 
 void LString::leftJustify(size_t width, LChar fill, bool truncate) {
@@ -487,30 +670,14 @@ void LString::leftJustify(size_t width, LChar fill, bool truncate) {
 		return;
 	}
 	size_t oldSize = size();
-	resize(width);
-	if (oldSize * 2 <= width)
-		std::copy(begin(), begin() + oldSize, begin() + (width - oldSize));
-	else
-		std::reverse_copy(begin(), begin() + oldSize, begin() + (width - oldSize));
-	Iterator i = begin();
-	Iterator e = begin() + (width - oldSize);
-	for (; i != e; i++) {
-		*i = fill;
-	}
-}
-
-LString::Iterator LString::find(LChar c) {
-	return find(c, begin());
-}
-
-
-LString::Iterator LString::find(LChar c, LString::Iterator start) {
-	for (Iterator i = start; i != end(); i++) {
-		if (*i == c) {
-			return i;
-		}
+	size_t padding = width - oldSize;
+	reserve(width, LStringData::requiredCharSize(fill));
+	LStringData *d = mutableData();
+	memmove(d->data() + padding * d->mCharSize, d->data(), oldSize * d->mCharSize);
+	for (size_t i = 0; i < padding; i++) {
+		d->setCharAt(i, fill);
 	}
-	return end();
+	d->mSize = width;
 }
 
 LString::ConstIterator LString::find(LChar c) const {
@@ -518,124 +685,49 @@ LString::ConstIterator LString::find(LChar c) const {
 }
 
 LString::ConstIterator LString::find(LChar c, LString::ConstIterator start) const {
-	for (ConstIterator i = start; i != cend(); i++) {
-		if (*i == c) {
-			return i;
-		}
-	}
-	return cend();
+	int index = indexOf(c, indexOfIterator(start));
+	return index == -1 ? cend() : cbegin() + index;
 }
 
 LString::ConstIterator LString::find(const LString &str) const {
 	return find(str, cbegin());
 }
 
-LString::Iterator LString::find(const LString &str) {
-	return find(str, begin());
-}
-
 LString::ConstIterator LString::find(const LString &str, LString::ConstIterator start) const {
-	ConstIterator si = str.cbegin();
-	ConstIterator index;
-	for (ConstIterator i = start; i != cend(); i++) {
-		if (*si == *i) {
-			if (si == str.cbegin()) {
-				index = i;
-			}
-			si++;
-			if (si == str.cend()) {
-				return index;
-			}
-			continue;
-		}
-
-		si = str.cbegin();
-	}
-	return cend();
-}
-
-LString::Iterator LString::find(const LString &str, LString::Iterator start) {
-	ConstIterator si = str.cbegin();
-	Iterator index;
-	for (Iterator i = start; i != cend(); i++) {
-		if (*si == *i) {
-			if (si == str.cbegin()) {
-				index = i;
-			}
-			si++;
-			if (si == str.cend()) {
-				return index;
-			}
-			continue;
-		}
-
-		si = str.cbegin();
-	}
-	return end();
+	int index = indexOf(str, indexOfIterator(start));
+	return index == -1 ? cend() : cbegin() + index;
 }
 
 int LString::indexOf(LChar c) const {
-	int index = 0;
-	for (ConstIterator i = cbegin(); i != cend(); ++i, index++) {
-		if (*i == c) return index;
-	}
-	return -1;
+	return indexOf(c, 0);
 }
 
 int LString::indexOf(LChar c, int start) const {
-	int index = start;
-	for (ConstIterator i = at(start); i != cend(); ++i, index++) {
-		if (*i == c) return index;
+	if (start < 0 || start >= (int)length()) return -1;
+	const LStringData *d = mData.unsafePointer();
+	if (d->isLatin1()) {
+		if (c > 0xFF) return -1;
+		return stringsearch::find(d->latin1(), d->mSize, static_cast<uint8_t>(c), start);
 	}
-	return -1;
+	return stringsearch::find(d->utf32(), d->mSize, c, start);
 }
 
 int LString::indexOf(const LString &str) const {
-	if (str.length() > this->length()) return -1;
-	if (str.length() == 1) return indexOf(str[0]);
-
-	ConstIterator si = str.cbegin();
-	int indexCounter = 0;
-	int index = 0;
-	for (ConstIterator i = cbegin(); i != cend(); i++, indexCounter++) {
-		if (*si == *i) {
-			if (si == str.cbegin()) {
-				index = indexCounter;
-			}
-			si++;
-			if (si == str.cend()) {
-				return index;
-			}
-			continue;
-		}
-
-		si = str.cbegin();
-	}
-	return -1;
+	return indexOf(str, 0);
 }
 
 int LString::indexOf(const LString &str, int start) const {
-	if (str.length() > this->length()) return -1;
+	if (str.isEmpty() || start < 0 || start + str.length() > this->length()) return -1;
 	if (str.length() == 1) return indexOf(str[0], start);
 
-	ConstIterator si = str.cbegin();
-	int indexCounter = start;
-	int index = 0;
-	for (ConstIterator i = at(start); i != cend(); i++, indexCounter++) {
-		if (*si == *i) {
-			if (si == str.cbegin()) {
-				index = indexCounter;
-			}
-			si++;
-			if (si == str.cend()) {
-				return index;
-			}
-			continue;
-		}
-
-		si = str.cbegin();
+	const LStringData *h = mData.unsafePointer();
+	const LStringData *n = str.mData.unsafePointer();
+	if (h->isLatin1()) {
+		if (n->isLatin1()) return stringsearch::find(h->latin1(), h->mSize, n->latin1(), n->mSize, start);
+		return indexOfUtf32(h->latin1(), h->mSize, n->utf32(), n->mSize, start);
 	}
-	return -1;
+	if (n->isLatin1()) return indexOfLatin1(h->utf32(), h->mSize, n->latin1(), n->mSize, start);
+	return stringsearch::find(h->utf32(), h->mSize, n->utf32(), n->mSize, start);
 }
 
 void LString::clear() {
@@ -644,17 +736,9 @@ void LString::clear() {
 
 void LString::remove(int start, int len) {
 	assert(start >= 0 && len > 0 && start + len <= (int)length());
-	detach();
-	LStringData *d = mData.unsafePointer();
-	if (start + len == (int)length()) {
-		d->mSize -= len;
-		d->begin()[start + len] = 0;
-	}
-	else {
-		memmove(d->begin() + start + len, d->begin() + start, d->mSize - (start + len));
-		d->mSize -= len;
-		d->begin()[start + len] = 0;
-	}
+	LStringData *d = mutableData();
+	memmove(d->data() + start * d->mCharSize, d->data() + (start + len) * d->mCharSize, (d->mSize - (start + len)) * d->mCharSize);
+	d->mSize -= len;
 }
 
 
@@ -664,75 +748,40 @@ int LString::toInt(bool *success) const {
 		if (success) *success = false;
 		return 0;
 	}
-
-	int val = 0;
-	LString::ConstIterator i;
-	for (i = this->cbegin(); i != this->cend(); i++) {
-		if (*i > U'9' || *i < U'0') break;
-		val *= 10;
-		val += *i - U'0';
-	}
-	if (i == this->cbegin() && success) *success = false;
-	return val;
-
-	/*if (sizeof(wchar_t) == sizeof(char32_t)) {
-		int val;
-		if (swscanf(reinterpret_cast<const wchar_t*>(mData->mData), L"%i", &val) != 1) {
-			if (success) *success = false;
-			return 0;
-		}
-		return val;
-	}*/
+	const LStringData *d = mData.unsafePointer();
+	if (d->isLatin1()) return numberconversion::parseInt(d->latin1(), d->mSize, success);
+	return numberconversion::parseInt(d->utf32(), d->mSize, success);
 }
 
-int LString::toFloat(bool *success) const {
+float LString::toFloat(bool *success) const {
 	if (isEmpty()) {
 		if (success) *success = false;
-		return 0;
-	}
-
-#ifndef _WIN32
-	assert(sizeof(wchar_t) == sizeof(char32_t));
-		float val = 0.0f;
-		if (swscanf(reinterpret_cast<const wchar_t*>(mData->begin()), L"%f", &val) != 1) {
-			if (success) *success = false;
-			return 0;
-		}
-		return val;
-#else
-	float val = 0.0f;
-	if (sscanf(toUtf8().c_str(), "%f", &val) != 1) {
-		if (success) *success = false;
-		return 0;
+		return 0.0f;
 	}
-	return val;
-#endif
-}
-
-LString::Iterator LString::begin() {
-	return isNull() ? 0 : mData->begin();
+	const LStringData *d = mData.unsafePointer();
+	if (d->isLatin1()) return numberconversion::parseFloat(d->latin1(), d->mSize, success);
+	return numberconversion::parseFloat(d->utf32(), d->mSize, success);
 }
 
 LString::ConstIterator LString::cbegin() const {
-	return isNull() ? 0 : mData->begin();
-}
-
-LString::Iterator LString::end() {
-	return isNull() ? 0 : mData->end();
+	if (isNull()) return ConstIterator();
+	return ConstIterator(mData->data(), mData->mCharSize);
 }
 
 LString::ConstIterator LString::cend() const {
-	return isNull() ? 0 : mData->end();
+	if (isNull()) return ConstIterator();
+	return ConstIterator(mData->data(), mData->mCharSize) + mData->mSize;
 }
 
-LString::Iterator LString::at(int i) {
+LString::ConstIterator LString::at(int i) const {
 	assert(i >= 0 && i < (int)length());
-	return mData->begin() + i;
+	return cbegin() + i;
 }
 
-LString::ConstIterator LString::at(int i) const {
+void LString::setChar(int i, LChar c) {
 	assert(i >= 0 && i < (int)length());
-	return mData->begin() + i;
+	reserve(length(), LStringData::requiredCharSize(c));
+	mutableData()->setCharAt(i, c);
 }
 
 bool LString::isNull() const {
@@ -743,6 +792,15 @@ bool LString::isEmpty() const {
 	return isNull() || mData->mSize == 0;
 }
 
+/**
+ * @brief LString::hash 32bit FNV-1a hash of the characters. The compiler calculates
+ * the same hash for string constants, so the algorithm must match StringValueType::constantStringHash.
+ */
+uint32_t LString::hash() const {
+	if (isNull()) return hashChars<uint8_t>(0, 0);
+	return mData->hash();
+}
+
 size_t LString::length() const {
 	return isNull() ? 0 : mData->mSize;
 }
@@ -752,46 +810,47 @@ size_t LString::capacity() const {
 }
 
 void LString::reserve(size_t size) {
-	if (size <= capacity()) return;
+	reserve(size, isNull() ? LStringData::Latin1 : mData.unsafePointer()->mCharSize);
+}
+
+/**
+ * @brief LString::reserve Makes room for size characters of the given width.
+ * Latin-1 strings are widened to UTF-32, but never narrowed.
+ */
+void LString::reserve(size_t size, LStringData::CharSize charSize) {
 	if (isNull()) {
-		mData = LStringData::create(size + 1);
+		mData = LStringData::create(size + 1, charSize);
 		return;
 	}
-	else {
-		LStringData *newData = LStringData::create(size + 1);
-		memcpy(newData->begin(), this->mData->begin(), this->mData->mSize * sizeof(LChar));
-		this->mData = newData;
-	}
+	LStringData *d = this->mData.unsafePointer();
+	if (size <= d->mCapacity && charSize <= d->mCharSize) return;
+	this->mData = LStringData::copy(d, std::max(size + 1, d->mCapacity), std::max(charSize, d->mCharSize));
 }
 
 void LString::resize(size_t size) {
 	if (this->size() == size) return;
-	if (isNull()) {
-		mData = LStringData::create(size + 1);
-		mData->mSize = size;
-		return;
-	}
-	else if (size <= this->capacity()) {
-		mData->mSize = size;
-		return;
-	}
-	else {
-		LStringData *oldData = this->mData.unsafePointer();
-		LStringData *newData = LStringData::create(size + 1);
-		memcpy(newData->begin(), oldData->begin(), oldData->mSize * sizeof(LChar));
-		newData->mSize = size;
-		this->mData = newData;
-	}
+	reserve(size);
+	mutableData()->mSize = size;
 }
 
 std::u32string LString::toU32String() const {
-	return std::u32string(cbegin(), cend());
+	std::u32string ret;
+	ret.reserve(length());
+	for (ConstIterator i = cbegin(); i != cend(); i++) {
+		ret += *i;
+	}
+	return ret;
 }
 
 std::wstring LString::toWString() const {
 #ifndef _WIN32
 	assert(sizeof(wchar_t) == sizeof(char32_t));
-	return std::wstring(cbegin(), cend());
+	std::wstring ret;
+	ret.reserve(length());
+	for (ConstIterator i = cbegin(); i != cend(); i++) {
+		ret += static_cast<wchar_t>(*i);
+	}
+	return ret;
 #else
 	wchar_t buffer[size() * 2];
 	size_t len = mbstowcs(buffer, toUtf8().c_str(), size());
@@ -801,170 +860,56 @@ std::wstring LString::toWString() const {
 
 const std::string &LString::toUtf8() const {
 	if (isEmpty()) return sNullStdString;
-	if (mData->mUtf8String) return *mData->mUtf8String;
-
-	std::string *utf8 = new std::string(mData->mSize * 4, '\0');
-	const LChar* fromNext;
+	const LStringData *d = mData.unsafePointer();
+	if (d->mUtf8Cache) return d->mUtf8Cache->mString;
+
+	// Latin-1 characters take at most two bytes in UTF-8
+	LStringData::Utf8Cache *cache = new LStringData::Utf8Cache;
+	std::string *utf8 = &cache->mString;
+	utf8->resize(d->mSize * (d->isLatin1() ? 2 : 4));
+	uint8_t *to = reinterpret_cast<uint8_t*>(&(*utf8)[0]);
+	uint8_t *toEnd = to + utf8->size();
 	uint8_t* toNext;
-	bool conversionValid = ucs4ToUtf8(cbegin(), cend(), fromNext, (uint8_t*)&(*utf8)[0], (uint8_t*)&(*utf8)[utf8->size()], toNext);
+	bool conversionValid;
+	if (d->isLatin1()) {
+		conversionValid = latin1ToUtf8(d->latin1(), d->latin1() + d->mSize, to, toEnd, toNext);
+	}
+	else {
+		const LChar* fromNext;
+		conversionValid = ucs4ToUtf8(d->utf32(), d->utf32() + d->mSize, fromNext, to, toEnd, toNext);
+	}
 	assert(conversionValid);
-	utf8->resize((char*)toNext - &(*utf8)[0]);
-	mData->mUtf8String = utf8;
-	return *mData->mUtf8String;
-}
-
-ALLEGRO_USTR *LString::toAllegroUStr() const {
+	utf8->resize(toNext - to);
+	cache->mAllegroString = 0;
+	d->mUtf8Cache = cache;
+	return cache->mString;
+}
+
+/**
+ * @brief LString::toAllegroUStr Returns the string as an ALLEGRO_USTR, which references the cached UTF-8
+ * characters without copying them. It's owned by the string and valid until the string is modified or destroyed.
+ * @return Null, if the string is empty.
+ */
+const ALLEGRO_USTR *LString::toAllegroUStr() const {
 	if (isEmpty()) return 0;
 	const std::string &utf8 = toUtf8();
-	return al_ustr_new_from_buffer(utf8.c_str(), utf8.size());
+	LStringData::Utf8Cache *cache = mData.unsafePointer()->mUtf8Cache;
+	if (!cache->mAllegroString) {
+		cache->mAllegroString = al_ref_buffer(&cache->mAllegroInfo, utf8.c_str(), utf8.size());
+	}
+	return cache->mAllegroString;
 }
 
+bool LString::latin1ToUtf8(const uint8_t *from, const uint8_t *fromEnd, uint8_t *to, uint8_t *toEnd, uint8_t *&toNext) {
+	return utfconversion::latin1ToUtf8(from, fromEnd, to, toEnd, toNext);
+}
 
 bool LString::ucs4ToUtf8(const LChar *from, const LChar *fromEnd, const LChar *&fromNext, uint8_t *to, uint8_t *toEnd, uint8_t *&toNext) {
-	const unsigned long Maxcode = 0x10FFFF;
-	fromNext = from;
-	toNext = to;
-	for (; fromNext < fromEnd; ++fromNext) {
-		uint32_t wc = *fromNext;
-		if ((wc & 0xFFFFF800) == 0x00D800 || wc > Maxcode)
-			return false;
-		if (wc < 0x000080) {
-			if (toEnd - toNext < 1)
-				return false;
-			*toNext++ = static_cast<uint8_t>(wc);
-		}
-		else if (wc < 0x000800) {
-			if (toEnd - toNext < 2)
-				return false;
-			*toNext++ = static_cast<uint8_t>(0xC0 | (wc >> 6));
-			*toNext++ = static_cast<uint8_t>(0x80 | (wc & 0x03F));
-		}
-		else if (wc < 0x010000) {
-			if (toEnd - toNext < 3)
-				return false;
-			*toNext++ = static_cast<uint8_t>(0xE0 |  (wc >> 12));
-			*toNext++ = static_cast<uint8_t>(0x80 | ((wc & 0x0FC0) >> 6));
-			*toNext++ = static_cast<uint8_t>(0x80 |  (wc & 0x003F));
-		}
-		else { // if (wc < 0x110000)
-			if (toEnd-toNext < 4)
-				return false;
-			*toNext++ = static_cast<uint8_t>(0xF0 |  (wc >> 18));
-			*toNext++ = static_cast<uint8_t>(0x80 | ((wc & 0x03F000) >> 12));
-			*toNext++ = static_cast<uint8_t>(0x80 | ((wc & 0x000FC0) >> 6));
-			*toNext++ = static_cast<uint8_t>(0x80 |  (wc & 0x00003F));
-		}
-	}
-	return true;
-}
-
-static const int halfShift  = 10; /* used for shifting by 10 bits */
-
-static const char32_t halfBase = 0x0010000UL;
-static const char32_t halfMask = 0x3FFUL;
-
-#define UNI_SUR_HIGH_START  (char32_t)0xD800
-#define UNI_SUR_HIGH_END    (char32_t)0xDBFF
-#define UNI_SUR_LOW_START   (char32_t)0xDC00
-#define UNI_SUR_LOW_END     (char32_t)0xDFFF
-
-#define UNI_REPLACEMENT_CHAR (char32_t)0x0000FFFD
-#define UNI_MAX_BMP (char32_t)0x0000FFFF
-#define UNI_MAX_UTF16 (char32_t)0x0010FFFF
-#define UNI_MAX_UTF32 (char32_t)0x7FFFFFFF
-#define UNI_MAX_LEGAL_UTF32 (char32_t)0x0010FFFF
-
-static const char trailingBytesForUTF8[256] = {
-	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2, 3,3,3,3,3,3,3,3,4,4,4,4,5,5,5,5
-};
-
-static const char32_t offsetsFromUTF8[6] = { 0x00000000UL, 0x00003080UL, 0x000E2080UL,
-			 0x03C82080UL, 0xFA082080UL, 0x82082080UL };
-
-
-static bool isLegalUTF8(const uint8_t *source, int length) {
-	uint8_t a;
-	const uint8_t *srcptr = source+length;
-	switch (length) {
-		default: return false;
-		/* Everything else falls through when "true"... */
-		case 4: if ((a = (*--srcptr)) < 0x80 || a > 0xBF) return false;
-		case 3: if ((a = (*--srcptr)) < 0x80 || a > 0xBF) return false;
-		case 2: if ((a = (*--srcptr)) > 0xBF) return false;
-
-		switch (*source) {
-			/* no fall-through in this inner switch */
-			case 0xE0: if (a < 0xA0) return false; break;
-			case 0xED: if (a > 0x9F) return false; break;
-			case 0xF0: if (a < 0x90) return false; break;
-			case 0xF4: if (a > 0x8F) return false; break;
-			default:   if (a < 0x80) return false;
-		}
-
-		case 1: if (*source >= 0x80 && *source < 0xC2) return false;
-	}
-	if (*source > 0xF4) return false;
-	return true;
+	return utfconversion::utf32ToUtf8(from, fromEnd, fromNext, to, toEnd, toNext);
 }
 
 bool LString::utf8ToUtf32(const uint8_t **sourceStart, const uint8_t *sourceEnd, LChar **targetStart, LChar *targetEnd) {
-	const uint8_t* source = *sourceStart;
-	LChar* target = *targetStart;
-	bool result = true;
-	while (source < sourceEnd) {
-		LChar ch = 0;
-		unsigned short extraBytesToRead = trailingBytesForUTF8[*source];
-		if (source + extraBytesToRead >= sourceEnd) {
-			result = false; break;
-		}
-		/* Do this check whether lenient or strict */
-		if (! isLegalUTF8(source, extraBytesToRead+1)) {
-			result = false;
-			break;
-		}
-		/*
-		 * The cases all fall through. See "Note A" below.
-		 */
-		switch (extraBytesToRead) {
-			case 5: ch += *source++; ch <<= 6;
-			case 4: ch += *source++; ch <<= 6;
-			case 3: ch += *source++; ch <<= 6;
-			case 2: ch += *source++; ch <<= 6;
-			case 1: ch += *source++; ch <<= 6;
-			case 0: ch += *source++;
-		}
-		ch -= offsetsFromUTF8[extraBytesToRead];
-
-		if (target >= targetEnd) {
-			source -= (extraBytesToRead+1); /* Back up the source pointer! */
-			result = false; break;
-		}
-		if (ch <= UNI_MAX_LEGAL_UTF32) {
-			/*
-			 * UTF-16 surrogate values are illegal in UTF-32, and anything
-			 * over Plane 17 (> 0x10FFFF) is illegal.
-			 */
-			if (ch >= UNI_SUR_HIGH_START && ch <= UNI_SUR_LOW_END) {
-				*target++ = UNI_REPLACEMENT_CHAR;
-			} else {
-				*target++ = ch;
-			}
-		} else { /* i.e., ch > UNI_MAX_LEGAL_UTF32 */
-			result = false;
-			*target++ = UNI_REPLACEMENT_CHAR;
-		}
-
-	}
-	*sourceStart = source;
-	*targetStart = target;
-	return result;
+	return utfconversion::utf8ToUtf32(*sourceStart, sourceEnd, *sourceStart, *targetStart, targetEnd, *targetStart);
 }
 
 bool LString::isWhitespace(LChar c) {
@@ -1017,7 +962,7 @@ int LString::indexOfIterator(LString::ConstIterator i) const {
 }
 
 bool LString::isValidIterator(LString::ConstIterator i) const {
-	return cbegin() <= i && cend() <= i;
+	return cbegin() <= i && i <= cend();
 }
 
 LString LString::arg(const LString &v1) {
@@ -1084,6 +1029,18 @@ void LString::detach() {
 	mData.detach();
 }
 
+/**
+ * @brief LString::mutableData Returns the data for modifying it in place. The data is copied,
+ * if it's shared, and the values cached from the characters are cleared.
+ */
+LStringData *LString::mutableData() {
+	mData.detach();
+	LStringData *d = mData.unsafePointer();
+	d->mHash = 0;
+	d->clearUtf8Cache();
+	return d;
+}
+
 
 
 //LString::StringDataPointer
@@ -1111,7 +1068,8 @@ LString::LSharedStringDataPointer &LString::LSharedStringDataPointer::operator =
 
 void LString::LSharedStringDataPointer::detach() {
 	if (!mPointer) return;
-	if (atomicLoad(mPointer->mRefCount) == 1) { //Only instance == no copy required
+	//Only instance == no copy required, unless the characters are in a constant buffer
+	if (atomicLoad(mPointer->mRefCount) == 1 && !mPointer->isStaticData()) {
 		return;
 	}
 
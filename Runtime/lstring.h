@@ -1,6 +1,8 @@
 #ifndef LSTRING_H
 #define LSTRING_H
 #include <sstream>
+#include <iterator>
+#include <cstddef>
 #include <string>
 #include <assert.h>
 #include <cstdint>
@@ -11,30 +13,74 @@ typedef char32_t LChar;
 
 class LStringData {
 	public:
-		static LStringData *create(size_t size);
+		/**
+		 * The width of a character in the buffer. Strings are stored as Latin-1 and
+		 * widened to UTF-32 only when they contain characters beyond U+00FF.
+		 */
+		enum CharSize {
+			Latin1 = 1,
+			Utf32 = sizeof(LChar)
+		};
+
+		static LStringData *create(size_t size, CharSize charSize = Latin1);
 		static LStringData *create(const LChar *text);
 		static LStringData *create(const LChar *text, size_t len);
+		static LStringData *create(const uint8_t *latin1, size_t len);
 		static LStringData *createFromBuffer(LChar *buffer);
 		static LStringData *createFromBuffer(LChar *buffer, size_t stringLength, size_t bufferSize);
+		static LStringData *createView(LStringData *parent, size_t start, size_t len);
 		static LStringData *copy(LStringData *o);
+		static LStringData *copy(LStringData *o, size_t size, CharSize charSize);
 		static void destruct(LStringData *d);
+		static CharSize requiredCharSize(const LChar *text, size_t len);
+		static CharSize requiredCharSize(LChar c) { return c > 0xFF ? Utf32 : Latin1; }
+		static bool equals(const LStringData *a, const LStringData *b);
 		void increase();
 		bool decrease();
 		bool isStaticData() const;
-
-		LChar *begin();
-		LChar *end();
-		const LChar *begin() const;
-		const LChar *end() const;
+		bool isView() const { return mParent != 0; }
+
+		/**
+		 * Immortal strings are shared by the whole program and never freed. Reference counting skips them.
+		 */
+		bool isImmortal() const { return atomicLoad(mRefCount) == ImmortalRefCount; }
+		void makeImmortal() { mRefCount = ImmortalRefCount; }
+
+		bool isLatin1() const { return mCharSize == Latin1; }
+		uint8_t *latin1() { return reinterpret_cast<uint8_t*>(data()); }
+		const uint8_t *latin1() const { return reinterpret_cast<const uint8_t*>(data()); }
+		LChar *utf32() { return reinterpret_cast<LChar*>(data()); }
+		const LChar *utf32() const { return reinterpret_cast<const LChar*>(data()); }
+		char *data() { return reinterpret_cast<char*>(this) + mOffset; }
+		const char *data() const { return reinterpret_cast<const char*>(this) + mOffset; }
+
+		LChar charAt(size_t i) const { return isLatin1() ? latin1()[i] : utf32()[i]; }
+		void setCharAt(size_t i, LChar c);
+		uint32_t hash() const;
+
+		/**
+		 * The string converted to UTF-8 and an Allegro string referencing it. Created on the
+		 * first use and kept until the characters are modified or the string is destroyed.
+		 */
+		struct Utf8Cache {
+			std::string mString;
+			ALLEGRO_USTR_INFO mAllegroInfo;
+			const ALLEGRO_USTR *mAllegroString;
+		};
+		void clearUtf8Cache();
 
 		mutable AtomicInt mRefCount;
-		mutable std::string *mUtf8String;
+		mutable Utf8Cache *mUtf8Cache;
 		size_t mSize;
 		size_t mCapacity;
 		intptr_t mOffset;
+		CharSize mCharSize;
+		LStringData *mParent; //The string, whose characters a view shares
+		mutable uint32_t mHash; //0, if not calculated yet
 
-		//LChar mRealData[mSize];
+		//uint8_t or LChar mRealData[mCapacity];
 	private:
+		enum { ImmortalRefCount = -1 };
 
 		//Don't implement
 		LStringData();
@@ -45,10 +91,45 @@ typedef CB_StringData* CBString;
 
 class LString {
 	public:
-		typedef LChar * iterator;
-		typedef const LChar * const_iterator;
-		typedef iterator Iterator;
-		typedef const_iterator ConstIterator;
+		/**
+		 * @brief The ConstIterator class iterates the characters of the string regardless of the width they are stored with.
+		 */
+		class ConstIterator {
+			public:
+				typedef std::random_access_iterator_tag iterator_category;
+				typedef LChar value_type;
+				typedef ptrdiff_t difference_type;
+				typedef const LChar *pointer;
+				typedef LChar reference;
+
+				ConstIterator() : mPointer(0), mCharSize(LStringData::Latin1) { }
+				ConstIterator(const char *pointer, LStringData::CharSize charSize) : mPointer(pointer), mCharSize(charSize) { }
+
+				LChar operator*() const { return mCharSize == LStringData::Latin1 ? *reinterpret_cast<const uint8_t*>(mPointer) : *reinterpret_cast<const LChar*>(mPointer); }
+				LChar operator[](ptrdiff_t i) const { return *(*this + i); }
+				ConstIterator &operator++() { mPointer += mCharSize; return *this; }
+				ConstIterator operator++(int) { ConstIterator r(*this); mPointer += mCharSize; return r; }
+				ConstIterator &operator--() { mPointer -= mCharSize; return *this; }
+				ConstIterator operator--(int) { ConstIterator r(*this); mPointer -= mCharSize; return r; }
+				ConstIterator &operator+=(ptrdiff_t i) { mPointer += i * mCharSize; return *this; }
+				ConstIterator &operator-=(ptrdiff_t i) { mPointer -= i * mCharSize; return *this; }
+				ConstIterator operator+(ptrdiff_t i) const { return ConstIterator(mPointer + i * mCharSize, mCharSize); }
+				ConstIterator operator-(ptrdiff_t i) const { return ConstIterator(mPointer - i * mCharSize, mCharSize); }
+				ptrdiff_t operator-(const ConstIterator &o) const { return (mPointer - o.mPointer) / mCharSize; }
+				bool operator==(const ConstIterator &o) const { return mPointer == o.mPointer; }
+				bool operator!=(const ConstIterator &o) const { return mPointer != o.mPointer; }
+				bool operator<(const ConstIterator &o) const { return mPointer < o.mPointer; }
+				bool operator<=(const ConstIterator &o) const { return mPointer <= o.mPointer; }
+				bool operator>(const ConstIterator &o) const { return mPointer > o.mPointer; }
+				bool operator>=(const ConstIterator &o) const { return mPointer >= o.mPointer; }
+
+				const char *data() const { return mPointer; }
+				LStringData::CharSize charSize() const { return mCharSize; }
+			private:
+				const char *mPointer;
+				LStringData::CharSize mCharSize;
+		};
+		typedef ConstIterator const_iterator;
 
 		LString();
 		LString(const LChar *str);
@@ -63,6 +144,8 @@ class LString {
 		static LString fromBuffer(LChar *buffer, size_t stringLength, size_t bufferSize);
 		static LString fromUtf8(const std::string &s);
 		static LString fromAscii(const std::string &s);
+		static LString fromLatin1(const uint8_t *str, size_t len);
+		static LString character(LChar c);
 		static LString number(int i, int base = 10);
 		static LString number(unsigned int i, int base = 10);
 		static LString number(float f);
@@ -77,8 +160,7 @@ class LString {
 		LString operator + (const LString &o) const;
 		LString & operator += (const LString &o);
 		LString & operator += (LChar c);
-		LChar &operator[] (int i);
-		const LChar &operator[] (int i) const;
+		LChar operator[] (int i) const;
 		operator CBString() const;
 
 		LString substr(int start, int len) const;
@@ -94,15 +176,11 @@ class LString {
 		void rightJustify(size_t width, LChar fill, bool truncate = false);
 		void leftJustify(size_t width, LChar fill, bool truncate = false);
 
-		Iterator find(LChar c);
-		Iterator find(LChar c, Iterator start);
 		ConstIterator find(LChar c) const;
 		ConstIterator find(LChar c, ConstIterator start) const;
 
 		ConstIterator find(const LString &str) const;
-		Iterator find(const LString &str);
 		ConstIterator find(const LString &str, ConstIterator start) const;
-		Iterator find(const LString &str, Iterator start);
 
 		int indexOf(LChar c) const;
 		int indexOf(LChar c, int start) const;
@@ -111,20 +189,25 @@ class LString {
 
 		void clear();
 
+		uint32_t hash() const;
+
 		void remove(int start, int len);
 
 		int toInt(bool *success = 0) const;
-		int toFloat(bool *success = 0) const;
+		float toFloat(bool *success = 0) const;
 
-		Iterator begin();
 		ConstIterator cbegin() const;
 		ConstIterator begin() const { return cbegin(); }
-		Iterator end();
 		ConstIterator cend() const;
 		ConstIterator end() const { return cend(); }
 
-		Iterator at(int i);
 		ConstIterator at(int i) const;
+		void setChar(int i, LChar c);
+
+		/**
+		 * @return True, if the characters are stored with one byte each.
+		 */
+		bool isLatin1() const { return isNull() || mData->isLatin1(); }
 
 
 		bool isNull() const;
@@ -138,11 +221,13 @@ class LString {
 		std::u32string toU32String() const;
 		std::wstring toWString() const;
 		const std::string &toUtf8() const;
-		ALLEGRO_USTR *toAllegroUStr() const;
+		const ALLEGRO_USTR *toAllegroUStr() const;
 
 		static bool ucs4ToUtf8(const LChar *from, const LChar *fromEnd, const LChar *&fromNext, uint8_t *to, uint8_t *toEnd, uint8_t *&toNext);
 		static bool utf8ToUtf32(const uint8_t **sourceStart, const uint8_t *sourceEnd, LChar **targetStart, LChar *targetEnd);
 
+		static bool latin1ToUtf8(const uint8_t *from, const uint8_t *fromEnd, uint8_t *to, uint8_t *toEnd, uint8_t *&toNext);
+
 		static bool isWhitespace(LChar c);
 		static char32_t toUpper(char32_t c);
 		static char32_t toLower(char32_t c);
@@ -157,6 +242,9 @@ class LString {
 		void detach();
 	private:
 		LString(LStringData *data);
+		void reserve(size_t size, LStringData::CharSize charSize);
+		LStringData *mutableData();
+		int compare(const LString &o) const;
 		class LSharedStringDataPointer {
 			public:
 				LSharedStringDataPointer() : mPointer(0) {}
@@ -0,0 +1,474 @@
+#include "numberconversion.h"
+#include <string.h>
+#include <stdlib.h>
+
+namespace {
+
+// Float to shortest decimal conversion from "Ryu: fast float-to-string conversion" by Ulf Adams.
+// The tables hold 2^k / 5^i and 5^i / 2^k rounded to 59 and 61 bits.
+const int floatMantissaBits = 23;
+const int floatExponentBits = 8;
+const int floatBias = 127;
+const int pow5InvBitCount = 59;
+const int pow5BitCount = 61;
+
+const uint64_t pow5InvSplit[32] = {
+	576460752303423489u, 461168601842738791u, 368934881474191033u,
+	295147905179352826u, 472236648286964522u, 377789318629571618u,
+	302231454903657294u, 483570327845851670u, 386856262276681336u,
+	309485009821345069u, 495176015714152110u, 396140812571321688u,
+	316912650057057351u, 507060240091291761u, 405648192073033409u,
+	324518553658426727u, 519229685853482763u, 415383748682786211u,
+	332306998946228969u, 531691198313966350u, 425352958651173080u,
+	340282366920938464u, 544451787073501542u, 435561429658801234u,
+	348449143727040987u, 557518629963265579u, 446014903970612463u,
+	356811923176489971u, 570899077082383953u, 456719261665907162u,
+	365375409332725730u, 292300327466180584u
+};
+
+const uint64_t pow5Split[48] = {
+	1152921504606846976u, 1441151880758558720u, 1801439850948198400u,
+	2251799813685248000u, 1407374883553280000u, 1759218604441600000u,
+	2199023255552000000u, 1374389534720000000u, 1717986918400000000u,
+	2147483648000000000u, 1342177280000000000u, 1677721600000000000u,
+	2097152000000000000u, 1310720000000000000u, 1638400000000000000u,
+	2048000000000000000u, 1280000000000000000u, 1600000000000000000u,
+	2000000000000000000u, 1250000000000000000u, 1562500000000000000u,
+	1953125000000000000u, 1220703125000000000u, 1525878906250000000u,
+	1907348632812500000u, 1192092895507812500u, 1490116119384765625u,
+	1862645149230957031u, 1164153218269348144u, 1455191522836685180u,
+	1818989403545856475u, 2273736754432320594u, 1421085471520200371u,
+	1776356839400250464u, 2220446049250313080u, 1387778780781445675u,
+	1734723475976807094u, 2168404344971008868u, 1355252715606880542u,
+	1694065894508600678u, 2117582368135750847u, 1323488980084844279u,
+	1654361225106055349u, 2067951531382569187u, 1292469707114105741u,
+	1615587133892632177u, 2019483917365790221u, 1262177448353618888u
+};
+
+// ceil(log2(5^e))
+inline int32_t pow5bits(int32_t e) {
+	return (int32_t)((((uint32_t)e) * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e))
+inline uint32_t log10Pow2(int32_t e) {
+	return (((uint32_t)e) * 78913) >> 18;
+}
+
+// floor(log10(5^e))
+inline uint32_t log10Pow5(int32_t e) {
+	return (((uint32_t)e) * 732923) >> 20;
+}
+
+inline bool multipleOfPowerOf5(uint32_t value, uint32_t p) {
+	uint32_t count = 0;
+	while (value % 5 == 0) {
+		value /= 5;
+		++count;
+	}
+	return count >= p;
+}
+
+inline bool multipleOfPowerOf2(uint32_t value, uint32_t p) {
+	return (value & ((1u << p) - 1)) == 0;
+}
+
+inline uint32_t mulShift(uint32_t m, uint64_t factor, int32_t shift) {
+	uint64_t low = (uint64_t)m * (uint32_t)factor;
+	uint64_t high = (uint64_t)m * (uint32_t)(factor >> 32);
+	return (uint32_t)(((low >> 32) + high) >> (shift - 32));
+}
+
+/**
+ * Finds the shortest decimal digits, which are closer to the float than to any other float.
+ * Returns the digits and sets exponent so that the value is digits * 10^exponent.
+ */
+uint32_t shortestDigits(uint32_t ieeeMantissa, uint32_t ieeeExponent, int32_t &exponent) {
+	int32_t e2;
+	uint32_t m2;
+	if (ieeeExponent == 0) {
+		e2 = 1 - floatBias - floatMantissaBits - 2;
+		m2 = ieeeMantissa;
+	}
+	else {
+		e2 = (int32_t)ieeeExponent - floatBias - floatMantissaBits - 2;
+		m2 = (1u << floatMantissaBits) | ieeeMantissa;
+	}
+	const bool acceptBounds = (m2 & 1) == 0;
+
+	// The float and the halfways to its neighbours, multiplied by 4
+	const uint32_t mv = 4 * m2;
+	const uint32_t mp = 4 * m2 + 2;
+	const uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+	const uint32_t mm = 4 * m2 - 1 - mmShift;
+
+	uint32_t vr, vp, vm;
+	int32_t e10;
+	bool vmIsTrailingZeros = false;
+	bool vrIsTrailingZeros = false;
+	uint8_t lastRemovedDigit = 0;
+	if (e2 >= 0) {
+		const uint32_t q = log10Pow2(e2);
+		e10 = (int32_t)q;
+		const int32_t k = pow5InvBitCount + pow5bits((int32_t)q) - 1;
+		const int32_t i = -e2 + (int32_t)q + k;
+		vr = mulShift(mv, pow5InvSplit[q], i);
+		vp = mulShift(mp, pow5InvSplit[q], i);
+		vm = mulShift(mm, pow5InvSplit[q], i);
+		if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+			const int32_t l = pow5InvBitCount + pow5bits((int32_t)(q - 1)) - 1;
+			lastRemovedDigit = (uint8_t)(mulShift(mv, pow5InvSplit[q - 1], -e2 + (int32_t)q - 1 + l) % 10);
+		}
+		if (q <= 9) {
+			// Only one of mp, mv and mm can be a multiple of 5, if any
+			if (mv % 5 == 0) {
+				vrIsTrailingZeros = multipleOfPowerOf5(mv, q);
+			}
+			else if (acceptBounds) {
+				vmIsTrailingZeros = multipleOfPowerOf5(mm, q);
+			}
+			else {
+				vp -= multipleOfPowerOf5(mp, q);
+			}
+		}
+	}
+	else {
+		const uint32_t q = log10Pow5(-e2);
+		e10 = (int32_t)q + e2;
+		const int32_t i = -e2 - (int32_t)q;
+		const int32_t k = pow5bits(i) - pow5BitCount;
+		int32_t j = (int32_t)q - k;
+		vr = mulShift(mv, pow5Split[i], j);
+		vp = mulShift(mp, pow5Split[i], j);
+		vm = mulShift(mm, pow5Split[i], j);
+		if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+			j = (int32_t)q - 1 - (pow5bits(i + 1) - pow5BitCount);
+			lastRemovedDigit = (uint8_t)(mulShift(mv, pow5Split[i + 1], j) % 10);
+		}
+		if (q <= 1) {
+			// mv has at least q trailing zero bits, so vr has at least q trailing decimal zeros
+			vrIsTrailingZeros = true;
+			if (acceptBounds) {
+				vmIsTrailingZeros = mmShift == 1;
+			}
+			else {
+				--vp;
+			}
+		}
+		else if (q < 31) {
+			vrIsTrailingZeros = multipleOfPowerOf2(mv, q - 1);
+		}
+	}
+
+	// Remove digits as long as the bounds allow it
+	int32_t removed = 0;
+	uint32_t output;
+	if (vmIsTrailingZeros || vrIsTrailingZeros) {
+		while (vp / 10 > vm / 10) {
+			vmIsTrailingZeros &= vm % 10 == 0;
+			vrIsTrailingZeros &= lastRemovedDigit == 0;
+			lastRemovedDigit = (uint8_t)(vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			++removed;
+		}
+		if (vmIsTrailingZeros) {
+			while (vm % 10 == 0) {
+				vrIsTrailingZeros &= lastRemovedDigit == 0;
+				lastRemovedDigit = (uint8_t)(vr % 10);
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				++removed;
+			}
+		}
+		if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0) {
+			// Round even, if exactly halfway
+			lastRemovedDigit = 4;
+		}
+		output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5);
+	}
+	else {
+		while (vp / 10 > vm / 10) {
+			lastRemovedDigit = (uint8_t)(vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			++removed;
+		}
+		output = vr + (vr == vm || lastRemovedDigit >= 5);
+	}
+	exponent = e10 + removed;
+	return output;
+}
+
+inline int decimalLength(uint32_t v) {
+	int len = 1;
+	while (v >= 10) {
+		v /= 10;
+		++len;
+	}
+	return len;
+}
+
+inline char *writeDigits(char *out, uint32_t digits, int len) {
+	for (int i = len - 1; i >= 0; --i) {
+		out[i] = (char)('0' + digits % 10);
+		digits /= 10;
+	}
+	return out + len;
+}
+
+// Powers of ten, which are exactly representable
+const float floatPowersOf10[] = {
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+const double doublePowersOf10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Deciding the rounding of any float needs less significant digits than this
+const int maxSignificantDigits = 120;
+// Digits which fit to the 64-bit mantissa without overflowing
+const int maxMantissaDigits = 19;
+
+template <typename T>
+inline bool isDigit(T c) {
+	return c >= '0' && c <= '9';
+}
+
+template <typename T>
+inline bool isSpace(T c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+template <typename T>
+const T *skipSpaceAndSign(const T *i, const T *end, bool &negative) {
+	while (i != end && isSpace(*i)) ++i;
+	negative = false;
+	if (i != end && (*i == '-' || *i == '+')) {
+		negative = *i == '-';
+		++i;
+	}
+	return i;
+}
+
+template <typename T>
+int parseIntChars(const T *str, size_t len, bool *success) {
+	const T *end = str + len;
+	bool negative;
+	const T *i = skipSpaceAndSign(str, end, negative);
+	const T *digitsBegin = i;
+	// Overflowing values wrap around
+	uint32_t val = 0;
+	while (i != end && isDigit(*i)) {
+		val = val * 10 + (uint32_t)(*i - '0');
+		++i;
+	}
+	if (success) *success = i != digitsBegin;
+	return (int)(negative ? 0u - val : val);
+}
+
+/**
+ * Computes digits * 10^exponent rounded to the nearest float, if it can be done exactly
+ * with a single float or double operation (Clinger's fast path).
+ */
+bool fastPathFloat(uint64_t digits, int exponent, float &result) {
+	if (digits <= (1u << 24) && exponent >= -10 && exponent <= 10) {
+		float f = (float)digits;
+		result = exponent >= 0 ? f * floatPowersOf10[exponent] : f / floatPowersOf10[-exponent];
+		return true;
+	}
+	if (digits <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+		double d = (double)digits;
+		d = exponent >= 0 ? d * doublePowersOf10[exponent] : d / doublePowersOf10[-exponent];
+		// Rounding the double to float again gives the correctly rounded float,
+		// unless the double is exactly halfway between two floats.
+		uint64_t bits;
+		memcpy(&bits, &d, sizeof(bits));
+		if ((bits & 0x1FFFFFFF) == 0x10000000) return false;
+		result = (float)d;
+		return true;
+	}
+	return false;
+}
+
+template <typename T>
+float parseFloatChars(const T *str, size_t len, bool *success) {
+	const T *end = str + len;
+	bool negative;
+	const T *i = skipSpaceAndSign(str, end, negative);
+
+	// The significant digits and the decimal exponent of the last one
+	char significant[maxSignificantDigits + 1];
+	int significantCount = 0;
+	bool nonZeroDropped = false;
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	bool hasDigits = false;
+	bool fraction = false;
+	for (; i != end; ++i) {
+		T c = *i;
+		if (c == '.' && !fraction) {
+			fraction = true;
+			continue;
+		}
+		if (!isDigit(c)) break;
+		hasDigits = true;
+		if (significantCount == 0 && c == '0') {
+			if (fraction) --exponent;
+			continue;
+		}
+		if (significantCount < maxSignificantDigits) {
+			if (significantCount < maxMantissaDigits) mantissa = mantissa * 10 + (uint64_t)(c - '0');
+			significant[significantCount++] = (char)c;
+			if (fraction) --exponent;
+		}
+		else {
+			if (c != '0') nonZeroDropped = true;
+			if (!fraction) ++exponent;
+		}
+	}
+	if (success) *success = hasDigits;
+	if (!hasDigits) return 0.0f;
+
+	if (i != end && (*i == 'e' || *i == 'E')) {
+		bool exponentNegative;
+		const T *expBegin = i + 1;
+		const T *j = expBegin;
+		if (j != end && (*j == '-' || *j == '+')) {
+			exponentNegative = *j == '-';
+			++j;
+		}
+		else {
+			exponentNegative = false;
+		}
+		if (j != end && isDigit(*j)) {
+			int e = 0;
+			for (; j != end && isDigit(*j); ++j) {
+				// Anything this large overflows or underflows anyway
+				if (e < 100000) e = e * 10 + (int)(*j - '0');
+			}
+			exponent += exponentNegative ? -e : e;
+		}
+	}
+
+	float result;
+	if (significantCount == 0) {
+		result = 0.0f;
+	}
+	else if (significantCount > maxMantissaDigits || nonZeroDropped || !fastPathFloat(mantissa, exponent, result)) {
+		// Rare cases are handed to strtof. Dropped nonzero digits only affect rounding, so
+		// a single extra digit is enough to represent them.
+		char buffer[maxSignificantDigits + 16];
+		char *out = buffer;
+		memcpy(out, significant, significantCount);
+		out += significantCount;
+		if (nonZeroDropped) {
+			*out++ = '1';
+			--exponent;
+		}
+		*out++ = 'e';
+		if (exponent < 0) {
+			*out++ = '-';
+			exponent = -exponent;
+		}
+		out = writeDigits(out, (uint32_t)exponent, decimalLength((uint32_t)exponent));
+		*out = 0;
+		result = strtof(buffer, 0);
+	}
+	return negative ? -result : result;
+}
+
+}
+
+namespace numberconversion {
+
+size_t formatFloat(float f, char *buffer) {
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	const bool negative = (bits >> 31) != 0;
+	const uint32_t ieeeMantissa = bits & ((1u << floatMantissaBits) - 1);
+	const uint32_t ieeeExponent = (bits >> floatMantissaBits) & ((1u << floatExponentBits) - 1);
+
+	char *out = buffer;
+	if (ieeeExponent == (1u << floatExponentBits) - 1) {
+		if (ieeeMantissa) {
+			memcpy(out, "nan", 3);
+			return 3;
+		}
+		if (negative) *out++ = '-';
+		memcpy(out, "inf", 3);
+		return out + 3 - buffer;
+	}
+	if (negative) *out++ = '-';
+	if (ieeeExponent == 0 && ieeeMantissa == 0) {
+		*out++ = '0';
+		return out - buffer;
+	}
+
+	int32_t exponent;
+	uint32_t digits = shortestDigits(ieeeMantissa, ieeeExponent, exponent);
+	int len = decimalLength(digits);
+	// Exponent of the first digit
+	int scientificExponent = exponent + len - 1;
+
+	// Like %g, but the exponent notation is used from 1e9 on instead of 1e6, so that the whole numbers
+	// up to nine digits are written out. All the digits are shown.
+	if (scientificExponent < -4 || scientificExponent >= 9) {
+		char digitChars[9];
+		writeDigits(digitChars, digits, len);
+		*out++ = digitChars[0];
+		if (len > 1) {
+			*out++ = '.';
+			memcpy(out, digitChars + 1, len - 1);
+			out += len - 1;
+		}
+		*out++ = 'e';
+		*out++ = scientificExponent < 0 ? '-' : '+';
+		uint32_t absExponent = scientificExponent < 0 ? -scientificExponent : scientificExponent;
+		out = writeDigits(out, absExponent, absExponent < 10 ? 2 : decimalLength(absExponent));
+	}
+	else if (exponent >= 0) {
+		out = writeDigits(out, digits, len);
+		memset(out, '0', exponent);
+		out += exponent;
+	}
+	else if (scientificExponent >= 0) {
+		char digitChars[9];
+		writeDigits(digitChars, digits, len);
+		memcpy(out, digitChars, scientificExponent + 1);
+		out += scientificExponent + 1;
+		*out++ = '.';
+		memcpy(out, digitChars + scientificExponent + 1, len - scientificExponent - 1);
+		out += len - scientificExponent - 1;
+	}
+	else {
+		*out++ = '0';
+		*out++ = '.';
+		memset(out, '0', -scientificExponent - 1);
+		out += -scientificExponent - 1;
+		out = writeDigits(out, digits, len);
+	}
+	return out - buffer;
+}
+
+int parseInt(const uint8_t *str, size_t len, bool *success) {
+	return parseIntChars(str, len, success);
+}
+
+int parseInt(const char32_t *str, size_t len, bool *success) {
+	return parseIntChars(str, len, success);
+}
+
+float parseFloat(const uint8_t *str, size_t len, bool *success) {
+	return parseFloatChars(str, len, success);
+}
+
+float parseFloat(const char32_t *str, size_t len, bool *success) {
+	return parseFloatChars(str, len, success);
+}
+
+}
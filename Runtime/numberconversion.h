@@ -0,0 +1,30 @@
+#ifndef NUMBERCONVERSION_H
+#define NUMBERCONVERSION_H
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Conversions between numbers and strings used by LString. They work directly on the characters
+ * without allocating anything.
+ * Floats are formatted with the shortest digits, which parse back to the same float (Ryu).
+ * The parsers skip leading whitespace and accept an optional sign. Parsing stops at the first
+ * character which can't be a part of the number. If success isn't null, it's set to false,
+ * if the string doesn't start with a number.
+ */
+namespace numberconversion {
+	// Enough for any float formatted by formatFloat
+	const size_t floatBufferSize = 24;
+
+	/**
+	 * @brief formatFloat Writes f to the buffer, which has to be at least floatBufferSize characters.
+	 * @return The number of characters written. The string isn't null terminated.
+	 */
+	size_t formatFloat(float f, char *buffer);
+
+	int parseInt(const uint8_t *str, size_t len, bool *success = 0);
+	int parseInt(const char32_t *str, size_t len, bool *success = 0);
+	float parseFloat(const uint8_t *str, size_t len, bool *success = 0);
+	float parseFloat(const char32_t *str, size_t len, bool *success = 0);
+}
+
+#endif // NUMBERCONVERSION_H
@@ -0,0 +1,27 @@
+#include "stringbuilder.h"
+
+StringBuilder::StringBuilder() {
+}
+
+StringBuilder::~StringBuilder() {
+}
+
+void StringBuilder::append(const LString &str) {
+	mString += str;
+}
+
+void StringBuilder::append(LChar c) {
+	mString += c;
+}
+
+size_t StringBuilder::length() const {
+	return mString.length();
+}
+
+LString StringBuilder::toString() const {
+	return mString;
+}
+
+void StringBuilder::clear() {
+	mString.clear();
+}
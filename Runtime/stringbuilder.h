@@ -0,0 +1,23 @@
+#ifndef STRINGBUILDER_H
+#define STRINGBUILDER_H
+#include "common.h"
+
+/**
+ * @brief The StringBuilder class collects a string piece by piece. The buffer grows geometrically,
+ * so appending is amortized constant time. toString shares the buffer with the returned string and
+ * the builder copies it only if it's appended to again.
+ */
+class StringBuilder {
+	public:
+		StringBuilder();
+		~StringBuilder();
+		void append(const LString &str);
+		void append(LChar c);
+		size_t length() const;
+		LString toString() const;
+		void clear();
+	private:
+		LString mString;
+};
+
+#endif // STRINGBUILDER_H
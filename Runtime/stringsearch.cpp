@@ -0,0 +1,137 @@
+#include "stringsearch.h"
+#include <string.h>
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define STRINGSEARCH_SIMD
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+	#define STRINGSEARCH_SIMD
+#endif
+
+// Needles at least this long are searched with Boyer-Moore-Horspool
+static const size_t horspoolMinNeedleLength = 32;
+
+namespace {
+
+template <typename T>
+int findScalar(const T *haystack, size_t haystackLen, const T *needle, size_t needleLen, size_t start) {
+	const T first = needle[0];
+	for (size_t i = start; i + needleLen <= haystackLen; ++i) {
+		if (haystack[i] == first && memcmp(haystack + i + 1, needle + 1, (needleLen - 1) * sizeof(T)) == 0) return (int)i;
+	}
+	return -1;
+}
+
+template <typename T>
+int findHorspool(const T *haystack, size_t haystackLen, const T *needle, size_t needleLen, size_t start) {
+	// The table is indexed by the low byte of the character. Characters sharing it get
+	// the shift of the rightmost one of them, which is always safe.
+	size_t shift[256];
+	for (size_t i = 0; i < 256; ++i) {
+		shift[i] = needleLen;
+	}
+	for (size_t i = 0; i + 1 < needleLen; ++i) {
+		shift[needle[i] & 0xFF] = needleLen - 1 - i;
+	}
+
+	const T last = needle[needleLen - 1];
+	size_t i = start;
+	while (i + needleLen <= haystackLen) {
+		T c = haystack[i + needleLen - 1];
+		if (c == last && memcmp(haystack + i, needle, (needleLen - 1) * sizeof(T)) == 0) return (int)i;
+		i += shift[c & 0xFF];
+	}
+	return -1;
+}
+
+#ifdef STRINGSEARCH_SIMD
+#if defined(__AVX2__)
+typedef __m256i Vector;
+inline Vector broadcast(uint8_t c) { return _mm256_set1_epi8((char)c); }
+inline Vector broadcast(char32_t c) { return _mm256_set1_epi32((int)c); }
+
+// One bit for every character equal to c
+inline uint32_t equalMask(const uint8_t *p, Vector c) {
+	return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), c));
+}
+
+inline uint32_t equalMask(const char32_t *p, Vector c) {
+	return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), c)));
+}
+#else
+typedef __m128i Vector;
+inline Vector broadcast(uint8_t c) { return _mm_set1_epi8((char)c); }
+inline Vector broadcast(char32_t c) { return _mm_set1_epi32((int)c); }
+
+// One bit for every character equal to c
+inline uint32_t equalMask(const uint8_t *p, Vector c) {
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), c));
+}
+
+inline uint32_t equalMask(const char32_t *p, Vector c) {
+	return (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), c)));
+}
+#endif
+
+template <typename T>
+int findSimd(const T *haystack, size_t haystackLen, const T *needle, size_t needleLen, size_t start) {
+	const size_t lanes = sizeof(Vector) / sizeof(T);
+	const Vector first = broadcast(needle[0]);
+	const Vector last = broadcast(needle[needleLen - 1]);
+	size_t i = start;
+	for (; i + needleLen - 1 + lanes <= haystackLen; i += lanes) {
+		uint32_t mask = equalMask(haystack + i, first) & equalMask(haystack + i + needleLen - 1, last);
+		while (mask) {
+			size_t index = i + __builtin_ctz(mask);
+			if (memcmp(haystack + index + 1, needle + 1, (needleLen - 2) * sizeof(T)) == 0) return (int)index;
+			mask &= mask - 1;
+		}
+	}
+	return findScalar(haystack, haystackLen, needle, needleLen, i);
+}
+#endif
+
+template <typename T>
+int findString(const T *haystack, size_t haystackLen, const T *needle, size_t needleLen, size_t start) {
+	if (needleLen == 0 || start + needleLen > haystackLen) return -1;
+	if (needleLen == 1) return stringsearch::find(haystack, haystackLen, needle[0], start);
+	if (needleLen >= horspoolMinNeedleLength) return findHorspool(haystack, haystackLen, needle, needleLen, start);
+#ifdef STRINGSEARCH_SIMD
+	return findSimd(haystack, haystackLen, needle, needleLen, start);
+#else
+	return findScalar(haystack, haystackLen, needle, needleLen, start);
+#endif
+}
+
+}
+
+int stringsearch::find(const uint8_t *haystack, size_t haystackLen, const uint8_t *needle, size_t needleLen, size_t start) {
+	return findString(haystack, haystackLen, needle, needleLen, start);
+}
+
+int stringsearch::find(const char32_t *haystack, size_t haystackLen, const char32_t *needle, size_t needleLen, size_t start) {
+	return findString(haystack, haystackLen, needle, needleLen, start);
+}
+
+int stringsearch::find(const uint8_t *haystack, size_t haystackLen, uint8_t c, size_t start) {
+	if (start >= haystackLen) return -1;
+	// memchr is vectorized by the C library
+	const void *found = memchr(haystack + start, c, haystackLen - start);
+	return found ? (int)(static_cast<const uint8_t*>(found) - haystack) : -1;
+}
+
+int stringsearch::find(const char32_t *haystack, size_t haystackLen, char32_t c, size_t start) {
+	size_t i = start;
+#ifdef STRINGSEARCH_SIMD
+	const size_t lanes = sizeof(Vector) / sizeof(char32_t);
+	const Vector v = broadcast(c);
+	for (; i + lanes <= haystackLen; i += lanes) {
+		uint32_t mask = equalMask(haystack + i, v);
+		if (mask) return (int)(i + __builtin_ctz(mask));
+	}
+#endif
+	for (; i < haystackLen; ++i) {
+		if (haystack[i] == c) return (int)i;
+	}
+	return -1;
+}
@@ -0,0 +1,20 @@
+#ifndef STRINGSEARCH_H
+#define STRINGSEARCH_H
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Substring search used by LString. Candidate positions are found by comparing the first and the last
+ * character of the needle to a whole SSE2 (or AVX2, if the runtime is compiled with it) register
+ * of the haystack at a time, and then verified with a full comparison. Long needles are searched with
+ * Boyer-Moore-Horspool, which skips over the haystack.
+ * All the functions return the index of the first match at or after start, or -1.
+ */
+namespace stringsearch {
+	int find(const uint8_t *haystack, size_t haystackLen, const uint8_t *needle, size_t needleLen, size_t start);
+	int find(const char32_t *haystack, size_t haystackLen, const char32_t *needle, size_t needleLen, size_t start);
+	int find(const uint8_t *haystack, size_t haystackLen, uint8_t c, size_t start);
+	int find(const char32_t *haystack, size_t haystackLen, char32_t c, size_t start);
+}
+
+#endif // STRINGSEARCH_H
@@ -0,0 +1,171 @@
+#include "stringtransform.h"
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define STRINGTRANSFORM_SIMD
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+	#define STRINGTRANSFORM_SIMD
+#endif
+
+namespace {
+
+#ifdef STRINGTRANSFORM_SIMD
+#if defined(__AVX2__)
+typedef __m256i Vector;
+inline Vector load(const void *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline void store(void *p, Vector v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+inline Vector broadcast(uint8_t c) { return _mm256_set1_epi8((char)c); }
+inline Vector broadcast(char32_t c) { return _mm256_set1_epi32((int)c); }
+inline Vector bitAnd(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+inline Vector bitOr(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+inline Vector bitXor(Vector a, Vector b) { return _mm256_xor_si256(a, b); }
+inline Vector equal(Vector a, Vector b, uint8_t) { return _mm256_cmpeq_epi8(a, b); }
+inline Vector equal(Vector a, Vector b, char32_t) { return _mm256_cmpeq_epi32(a, b); }
+inline Vector greater(Vector a, Vector b, uint8_t) { return _mm256_cmpgt_epi8(a, b); }
+inline Vector greater(Vector a, Vector b, char32_t) { return _mm256_cmpgt_epi32(a, b); }
+inline uint32_t byteMask(Vector v) { return (uint32_t)_mm256_movemask_epi8(v); }
+#else
+typedef __m128i Vector;
+inline Vector load(const void *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline void store(void *p, Vector v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+inline Vector broadcast(uint8_t c) { return _mm_set1_epi8((char)c); }
+inline Vector broadcast(char32_t c) { return _mm_set1_epi32((int)c); }
+inline Vector bitAnd(Vector a, Vector b) { return _mm_and_si128(a, b); }
+inline Vector bitOr(Vector a, Vector b) { return _mm_or_si128(a, b); }
+inline Vector bitXor(Vector a, Vector b) { return _mm_xor_si128(a, b); }
+inline Vector equal(Vector a, Vector b, uint8_t) { return _mm_cmpeq_epi8(a, b); }
+inline Vector equal(Vector a, Vector b, char32_t) { return _mm_cmpeq_epi32(a, b); }
+inline Vector greater(Vector a, Vector b, uint8_t) { return _mm_cmpgt_epi8(a, b); }
+inline Vector greater(Vector a, Vector b, char32_t) { return _mm_cmpgt_epi32(a, b); }
+inline uint32_t byteMask(Vector v) { return (uint32_t)_mm_movemask_epi8(v); }
+#endif
+
+// movemask of a vector with every byte set
+const uint32_t fullMask = (uint32_t)((1ull << sizeof(Vector)) - 1);
+
+// Bytes of the non-ASCII characters. The comparisons are signed, so Latin-1 characters
+// over 0x7F are negative and UTF-32 characters never are.
+inline uint32_t nonAsciiMask(Vector v, uint8_t) { return byteMask(v); }
+inline uint32_t nonAsciiMask(Vector v, char32_t) { return byteMask(greater(v, broadcast(char32_t(0x7F)), char32_t())); }
+
+/**
+ * Flips the case of the ASCII letters between first and last, if all the characters of the block are ASCII.
+ */
+template <typename T>
+inline bool mapAsciiCase(T *dest, const T *src, T first, T last) {
+	Vector v = load(src);
+	if (nonAsciiMask(v, T())) return false;
+	Vector inRange = bitAnd(greater(v, broadcast(T(first - 1)), T()), greater(broadcast(T(last + 1)), v, T()));
+	store(dest, bitXor(v, bitAnd(inRange, broadcast(T(0x20)))));
+	return true;
+}
+
+template <typename T>
+inline uint32_t whitespaceMask(const T *p) {
+	Vector v = load(p);
+	Vector ws = equal(v, broadcast(T(' ')), T());
+	ws = bitOr(ws, equal(v, broadcast(T('\t')), T()));
+	ws = bitOr(ws, equal(v, broadcast(T('\n')), T()));
+	ws = bitOr(ws, equal(v, broadcast(T('\f')), T()));
+	ws = bitOr(ws, equal(v, broadcast(T('\r')), T()));
+	return byteMask(ws);
+}
+#endif
+
+template <typename T>
+inline bool isWhitespace(T c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r';
+}
+
+template <typename T>
+void mapCase(T *dest, const T *src, size_t len, T first, T last, stringtransform::CharMapping unicodeMapping) {
+	size_t i = 0;
+	while (i < len) {
+		size_t scalarEnd = len;
+#ifdef STRINGTRANSFORM_SIMD
+		const size_t lanes = sizeof(Vector) / sizeof(T);
+		if (i + lanes <= len) {
+			if (mapAsciiCase(dest + i, src + i, first, last)) {
+				i += lanes;
+				continue;
+			}
+			scalarEnd = i + lanes;
+		}
+#else
+		(void)first;
+		(void)last;
+#endif
+		for (; i < scalarEnd; ++i) {
+			dest[i] = static_cast<T>(unicodeMapping(src[i]));
+		}
+	}
+}
+
+template <typename T>
+size_t leading(const T *str, size_t len) {
+	size_t i = 0;
+#ifdef STRINGTRANSFORM_SIMD
+	const size_t lanes = sizeof(Vector) / sizeof(T);
+	for (; i + lanes <= len; i += lanes) {
+		uint32_t mask = ~whitespaceMask(str + i) & fullMask;
+		if (mask) return i + __builtin_ctz(mask) / sizeof(T);
+	}
+#endif
+	while (i < len && isWhitespace(str[i])) {
+		++i;
+	}
+	return i;
+}
+
+template <typename T>
+size_t trailing(const T *str, size_t len) {
+	size_t end = len;
+#ifdef STRINGTRANSFORM_SIMD
+	const size_t lanes = sizeof(Vector) / sizeof(T);
+	for (; end >= lanes; end -= lanes) {
+		uint32_t mask = ~whitespaceMask(str + end - lanes) & fullMask;
+		if (mask) {
+			size_t lastNonWhitespace = end - lanes + (31 - __builtin_clz(mask)) / sizeof(T);
+			return len - lastNonWhitespace - 1;
+		}
+	}
+#endif
+	while (end > 0 && isWhitespace(str[end - 1])) {
+		--end;
+	}
+	return len - end;
+}
+
+}
+
+void stringtransform::toUpper(uint8_t *dest, const uint8_t *src, size_t len, CharMapping unicodeToUpper) {
+	mapCase<uint8_t>(dest, src, len, 'a', 'z', unicodeToUpper);
+}
+
+void stringtransform::toUpper(char32_t *dest, const char32_t *src, size_t len, CharMapping unicodeToUpper) {
+	mapCase<char32_t>(dest, src, len, U'a', U'z', unicodeToUpper);
+}
+
+void stringtransform::toLower(uint8_t *dest, const uint8_t *src, size_t len, CharMapping unicodeToLower) {
+	mapCase<uint8_t>(dest, src, len, 'A', 'Z', unicodeToLower);
+}
+
+void stringtransform::toLower(char32_t *dest, const char32_t *src, size_t len, CharMapping unicodeToLower) {
+	mapCase<char32_t>(dest, src, len, U'A', U'Z', unicodeToLower);
+}
+
+size_t stringtransform::leadingWhitespace(const uint8_t *str, size_t len) {
+	return leading(str, len);
+}
+
+size_t stringtransform::leadingWhitespace(const char32_t *str, size_t len) {
+	return leading(str, len);
+}
+
+size_t stringtransform::trailingWhitespace(const uint8_t *str, size_t len) {
+	return trailing(str, len);
+}
+
+size_t stringtransform::trailingWhitespace(const char32_t *str, size_t len) {
+	return trailing(str, len);
+}
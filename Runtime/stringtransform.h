@@ -0,0 +1,33 @@
+#ifndef STRINGTRANSFORM_H
+#define STRINGTRANSFORM_H
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Case conversion and whitespace scanning used by LString. Runs of ASCII are handled a whole
+ * SSE2 (or AVX2, if the runtime is compiled with it) register at a time. Blocks with other
+ * characters are mapped one by one with the given function.
+ */
+namespace stringtransform {
+	typedef char32_t (*CharMapping)(char32_t);
+
+	void toUpper(uint8_t *dest, const uint8_t *src, size_t len, CharMapping unicodeToUpper);
+	void toUpper(char32_t *dest, const char32_t *src, size_t len, CharMapping unicodeToUpper);
+	void toLower(uint8_t *dest, const uint8_t *src, size_t len, CharMapping unicodeToLower);
+	void toLower(char32_t *dest, const char32_t *src, size_t len, CharMapping unicodeToLower);
+
+	/**
+	 * @return The number of whitespace characters at the beginning. The whitespace characters are
+	 * the same as with LString::isWhitespace.
+	 */
+	size_t leadingWhitespace(const uint8_t *str, size_t len);
+	size_t leadingWhitespace(const char32_t *str, size_t len);
+
+	/**
+	 * @return The number of whitespace characters at the end.
+	 */
+	size_t trailingWhitespace(const uint8_t *str, size_t len);
+	size_t trailingWhitespace(const char32_t *str, size_t len);
+}
+
+#endif // STRINGTRANSFORM_H
@@ -1,11 +1,116 @@
 #include "types.h"
 #include "error.h"
 #include <cstdio>
+#include <cstddef>
+#include <vector>
+
+#ifdef _WIN32
+	#include <malloc.h>
+#endif
+
+// Size of the chunks the members are allocated from
+static const unsigned int typeMemberChunkSize = 4096;
+
+// Size and alignment of the contiguous storage chunks. Because the chunks are aligned
+// to their size, the chunk of a member is found by masking the address of the member.
+static const uintptr_t contiguousChunkSize = 65536;
+
+/**
+ * @brief The CB_TypeMemberChunk struct is the header of a contiguous storage chunk. The members follow it.
+ */
+struct CB_TypeMemberChunk {
+	CB_TypeMemberChunk *mNextEmpty;
+	unsigned int mMembers;
+};
+
+// Keeps the members 16 byte aligned
+static const uintptr_t contiguousChunkHeaderSize = (sizeof(CB_TypeMemberChunk) + 15) & ~15;
+
+// A handle consists of a slot index in the low bits and the generation of the slot in the high bits.
+// The generation is increased when the member is deleted, so that old handles of the slot are detected.
+// A slot whose generation would wrap around is retired instead of being reused, so a handle is never
+// given out twice. The free slots are reused in FIFO order to spread the generations over all the slots.
+static const int handleIndexBits = 20;
+static const uint32_t handleIndexMask = (1u << handleIndexBits) - 1;
+static const uint32_t handleGenerationMask = (1u << (31 - handleIndexBits)) - 1;
+
+/**
+ * @brief The CB_TypeHandleTable struct maps handles to the members of a CB_Type.
+ */
+struct CB_TypeHandleTable {
+	struct Slot {
+		CB_TypeMember *mMember;
+		uint32_t mGeneration;
+		uint32_t mNextFree;
+	};
+
+	// Slot 0 is never used, so 0 is never a valid handle
+	CB_TypeHandleTable() : mSlots(1), mFreeSlot(0), mLastFreeSlot(0) { }
+
+	void releaseSlot(uint32_t index) {
+		Slot &slot = mSlots[index];
+		slot.mMember = 0;
+		if (slot.mGeneration == handleGenerationMask) return;
+		slot.mGeneration++;
+		slot.mNextFree = 0;
+		if (mLastFreeSlot) {
+			mSlots[mLastFreeSlot].mNextFree = index;
+		}
+		else {
+			mFreeSlot = index;
+		}
+		mLastFreeSlot = index;
+	}
+
+	uint32_t takeFreeSlot() {
+		uint32_t index = mFreeSlot;
+		mFreeSlot = mSlots[index].mNextFree;
+		if (!mFreeSlot) mLastFreeSlot = 0;
+		return index;
+	}
+
+	std::vector<Slot> mSlots;
+	// The oldest and the newest free slot
+	uint32_t mFreeSlot;
+	uint32_t mLastFreeSlot;
+};
+
+static CB_TypeMemberChunk *allocateContiguousChunk() {
+	void *ptr = 0;
+#ifdef _WIN32
+	ptr = _aligned_malloc(contiguousChunkSize, contiguousChunkSize);
+#else
+	if (posix_memalign(&ptr, contiguousChunkSize, contiguousChunkSize) != 0) ptr = 0;
+#endif
+	if (!ptr) {
+		error(U"CB_New: Out of memory");
+		exit(1);
+	}
+	return static_cast<CB_TypeMemberChunk*>(ptr);
+}
+
+static CB_TypeMemberChunk *chunkOfMember(CB_TypeMember *m) {
+	return reinterpret_cast<CB_TypeMemberChunk*>(reinterpret_cast<uintptr_t>(m) & ~(contiguousChunkSize - 1));
+}
+
+void CB_Type::construct(unsigned int sizeOfMember, bool contiguous) {
+	mFirst = 0;
+	mLast = 0;
+	mSizeOfMember = sizeOfMember;
+	mFreeList = 0;
+	mChunkPosition = 0;
+	mChunkEnd = 0;
+	// Huge members don't fit to the chunks
+	mContiguous = contiguous && sizeOfMember <= contiguousChunkSize - contiguousChunkHeaderSize;
+	mCurrentChunk = 0;
+	mEmptyChunks = 0;
+	mHandles = 0;
+}
 
 CB_TypeMember *CB_Type::createMemberToEnd() {
-	char *memberData = new char[mSizeOfMember];
-	CB_TypeMember *member = reinterpret_cast<CB_TypeMember*>(memberData);
+	CB_TypeMember *member = mContiguous ? allocateContiguousMember() : allocateMember();
 	member->mType = this;
+	member->mHandle = 0;
 	memset(member->mData, 0, sizeOfMemberData());
 	insertLast(member);
 	return member;
@@ -34,9 +139,198 @@ void CB_Type::deleteMember(CB_TypeMember *m) {
 		}
 	}
 
-	delete [] reinterpret_cast<char*>(m);
+	if (m->mHandle) {
+		mHandles->releaseSlot(m->mHandle & handleIndexMask);
+		m->mHandle = 0;
+	}
+
+	if (mContiguous) {
+		releaseContiguousMember(m);
+		return;
+	}
+	// mAfter is left untouched, so that For Each can continue from a deleted member
+	m->mBefore = mFreeList;
+	mFreeList = m;
+}
+
+CB_TypeMember *CB_Type::allocateMember() {
+	if (mFreeList) {
+		CB_TypeMember *member = mFreeList;
+		mFreeList = member->mBefore;
+		return member;
+	}
+	if (mChunkEnd - mChunkPosition < (ptrdiff_t)mSizeOfMember) {
+		allocateChunk();
+	}
+	CB_TypeMember *member = reinterpret_cast<CB_TypeMember*>(mChunkPosition);
+	mChunkPosition += mSizeOfMember;
+	return member;
+}
+
+void CB_Type::allocateChunk() {
+	// The chunks live as long as the program. Deleted members are reused through the free list.
+	unsigned int membersPerChunk = typeMemberChunkSize / mSizeOfMember;
+	if (membersPerChunk == 0) membersPerChunk = 1;
+	unsigned int chunkSize = membersPerChunk * mSizeOfMember;
+	mChunkPosition = new char[chunkSize];
+	mChunkEnd = mChunkPosition + chunkSize;
 }
 
+CB_TypeMember *CB_Type::allocateContiguousMember() {
+	if (!mCurrentChunk || mChunkEnd - mChunkPosition < (ptrdiff_t)mSizeOfMember) {
+		if (mEmptyChunks) {
+			mCurrentChunk = mEmptyChunks;
+			mEmptyChunks = mEmptyChunks->mNextEmpty;
+		}
+		else {
+			mCurrentChunk = allocateContiguousChunk();
+		}
+		mCurrentChunk->mNextEmpty = 0;
+		mCurrentChunk->mMembers = 0;
+		mChunkPosition = reinterpret_cast<char*>(mCurrentChunk) + contiguousChunkHeaderSize;
+		mChunkEnd = reinterpret_cast<char*>(mCurrentChunk) + contiguousChunkSize;
+	}
+	CB_TypeMember *member = reinterpret_cast<CB_TypeMember*>(mChunkPosition);
+	mChunkPosition += mSizeOfMember;
+	mCurrentChunk->mMembers++;
+	return member;
+}
+
+void CB_Type::releaseContiguousMember(CB_TypeMember *m) {
+	CB_TypeMemberChunk *chunk = chunkOfMember(m);
+	assert(chunk->mMembers > 0);
+	if (--chunk->mMembers != 0) return;
+
+	if (chunk == mCurrentChunk) {
+		// Start filling the current chunk from the beginning
+		mChunkPosition = reinterpret_cast<char*>(chunk) + contiguousChunkHeaderSize;
+	}
+	else {
+		chunk->mNextEmpty = mEmptyChunks;
+		mEmptyChunks = chunk;
+	}
+}
+
+int CB_Type::handle(CB_TypeMember *m) {
+	if (!m) return 0;
+	if (m->mHandle) return m->mHandle;
+	if (!mHandles) mHandles = new CB_TypeHandleTable;
+
+	uint32_t index;
+	if (mHandles->mFreeSlot) {
+		index = mHandles->takeFreeSlot();
+	}
+	else {
+		// Hard limit of 2^20 - 1 slots, which is the maximum number of members with a handle
+		// at the same time. The retired slots count towards the limit too.
+		index = mHandles->mSlots.size();
+		if (index > handleIndexMask) {
+			error(U"ConvertToInteger: Too many handles");
+			exit(1);
+		}
+		CB_TypeHandleTable::Slot slot;
+		slot.mGeneration = 0;
+		mHandles->mSlots.push_back(slot);
+	}
+	CB_TypeHandleTable::Slot &slot = mHandles->mSlots[index];
+	slot.mMember = m;
+	slot.mNextFree = 0;
+	m->mHandle = (int)((slot.mGeneration << handleIndexBits) | index);
+	return m->mHandle;
+}
+
+CB_TypeMember *CB_Type::memberByHandle(int handle) {
+	if (!mHandles || handle <= 0) return 0;
+	uint32_t index = (uint32_t)handle & handleIndexMask;
+	if (index >= mHandles->mSlots.size()) return 0;
+	const CB_TypeHandleTable::Slot &slot = mHandles->mSlots[index];
+	if (slot.mGeneration != ((uint32_t)handle >> handleIndexBits)) return 0;
+	return slot.mMember;
+}
+
+namespace {
+template <typename T>
+struct FieldLess {
+	FieldLess(unsigned int offset, bool descending) : mOffset(offset), mDescending(descending) { }
+	T key(const CB_TypeMember *m) const { return *reinterpret_cast<const T*>(reinterpret_cast<const char*>(m) + mOffset); }
+	bool operator()(const CB_TypeMember *a, const CB_TypeMember *b) const { return mDescending ? key(b) < key(a) : key(a) < key(b); }
+	unsigned int mOffset;
+	bool mDescending;
+};
+
+struct StringFieldLess {
+	StringFieldLess(unsigned int offset, bool descending) : mOffset(offset), mDescending(descending) { }
+	LString key(const CB_TypeMember *m) const { return LString(*reinterpret_cast<const CBString*>(reinterpret_cast<const char*>(m) + mOffset)); }
+	bool operator()(const CB_TypeMember *a, const CB_TypeMember *b) const { return mDescending ? key(b) < key(a) : key(a) < key(b); }
+	unsigned int mOffset;
+	bool mDescending;
+};
+}
+
+void CB_Type::sort(unsigned int fieldOffset, SortKeyType keyType, bool descending) {
+	switch (keyType) {
+		case skInteger:
+			sortMembers(FieldLess<int32_t>(fieldOffset, descending)); break;
+		case skFloat:
+			sortMembers(FieldLess<float>(fieldOffset, descending)); break;
+		case skString:
+			sortMembers(StringFieldLess(fieldOffset, descending)); break;
+		case skShort:
+			sortMembers(FieldLess<uint16_t>(fieldOffset, descending)); break;
+		case skByte:
+			sortMembers(FieldLess<uint8_t>(fieldOffset, descending)); break;
+	}
+}
+
+// Bottom-up merge sort of the list linked with mAfter. Runs of 1, 2, 4... members are merged until
+// only one run is left. Equal members keep their order. mBefore links are fixed afterwards.
+template <typename Less>
+void CB_Type::sortMembers(Less less) {
+	if (!mFirst) return;
+	CB_TypeMember *list = mFirst;
+	for (unsigned int runSize = 1;; runSize *= 2) {
+		CB_TypeMember *p = list;
+		CB_TypeMember *tail = 0;
+		list = 0;
+		int merges = 0;
+		while (p) {
+			merges++;
+			CB_TypeMember *q = p;
+			unsigned int pSize = 0;
+			while (pSize < runSize && q) {
+				pSize++;
+				q = q->mAfter;
+			}
+			unsigned int qSize = runSize;
+
+			while (pSize > 0 || (qSize > 0 && q)) {
+				CB_TypeMember *e;
+				if (pSize == 0) {
+					e = q; q = q->mAfter; qSize--;
+				}
+				else if (qSize == 0 || !q || !less(q, p)) {
+					e = p; p = p->mAfter; pSize--;
+				}
+				else {
+					e = q; q = q->mAfter; qSize--;
+				}
+				if (tail) tail->mAfter = e; else list = e;
+				tail = e;
+			}
+			p = q;
+		}
+		tail->mAfter = 0;
+		if (merges <= 1) break;
+	}
+
+	CB_TypeMember *before = 0;
+	for (CB_TypeMember *m = list; m; m = m->mAfter) {
+		m->mBefore = before;
+		before = m;
+	}
+	mFirst = list;
+	mLast = before;
+}
 
 void CB_Type::insertLast(CB_TypeMember *member) {
 	if (mLast) {
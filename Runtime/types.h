@@ -3,6 +3,8 @@
 #include "common.h"
 
 struct CB_Type;
+struct CB_TypeMemberChunk;
+struct CB_TypeHandleTable;
 /**
  * @brief The CB_TypeMember struct is a member of CB_Type.
  *
@@ -17,11 +19,16 @@ struct CB_TypeMember {
 		CB_Type *type() const { return mType; }
 		void *data() { return static_cast<void*>(mData); }
 	private:
-		// 1. mAfter, 2. mBefore, 3. mType, 4. mData
+		// 1. mAfter, 2. mBefore, 3. mType, 4. mHandle, 5. mData
 		CB_TypeMember *mAfter;
 		CB_TypeMember *mBefore;
 		CB_Type *mType;
 
+		/**
+		 * @brief mHandle is the handle of the member or 0, if no handle has been requested.
+		 */
+		int mHandle;
+
 		/**
 		 * @brief mData is pointer to the start of the data
 		 */
@@ -30,10 +37,34 @@ struct CB_TypeMember {
 
 /**
  * @brief The CB_Type struct is the base of the linked list.
+ *
+ * Members are allocated from page-sized chunks owned by the CB_Type. Deleted members are put to a free list
+ * and reused by the following New, so creating and deleting members doesn't go through malloc.
+ *
+ * With the contiguous storage, new members are always placed after the previous member, so the list order
+ * matches the memory order and iterating the list is nearly sequential memory access. Space of deleted
+ * members is reclaimed lazily, when every member of a chunk has been deleted. Members never move.
+ *
+ * CB_Type is constructed by CB_ConstructType or CB_ConstructContiguousType, not by a constructor.
+ *
+ * DO NOT CHANGE THE ORDER OF mFirst AND mLast, the compiler reads them directly.
  */
 struct CB_Type {
 		//friend void CBF_CB_ConstructType(CB_Type *, unsigned int);
 	public:
+		/**
+		 * @brief The SortKeyType enum tells the type of the field SortType compares.
+		 * The values have to match TypeValueType::SortKeyType of the compiler.
+		 */
+		enum SortKeyType {
+			skInteger = 0,
+			skFloat,
+			skString,
+			skShort,
+			skByte
+		};
+
+		void construct(unsigned int sizeOfMember, bool contiguous);
 		CB_TypeMember *createMemberToEnd();
 		CB_TypeMember *firstMember() { return mFirst; }
 		CB_TypeMember *lastMember() { return mLast; }
@@ -43,11 +74,54 @@ struct CB_Type {
 		void setSizeOfMember(unsigned int s) { mSizeOfMember = s; }
 		unsigned int sizeOfMember() { return mSizeOfMember; }
 		unsigned int sizeOfMemberData() { return mSizeOfMember - offsetof(CB_TypeMember, mData); }
+
+		/**
+		 * @brief handle Returns a handle of the member, which can be converted back to the member with memberByHandle.
+		 * The handle stays valid until the member is deleted and is never given to another member. Null member has handle 0.
+		 * At most 2^20 - 1 members of the type can have a handle at the same time.
+		 */
+		int handle(CB_TypeMember *m);
+
+		/**
+		 * @brief memberByHandle Returns the member of the handle in O(1) time or null if the member has been deleted
+		 * or the handle is otherwise invalid.
+		 */
+		CB_TypeMember *memberByHandle(int handle);
+
+		/**
+		 * @brief sort Sorts the members by the field at fieldOffset (bytes from the beginning of the member).
+		 * The sort is stable and done in place in O(n log n) time.
+		 */
+		void sort(unsigned int fieldOffset, SortKeyType keyType, bool descending);
 	private:
 		void insertLast(CB_TypeMember *member);
+		CB_TypeMember *allocateMember();
+		void allocateChunk();
+		CB_TypeMember *allocateContiguousMember();
+		void releaseContiguousMember(CB_TypeMember *m);
+		template <typename Less> void sortMembers(Less less);
 		CB_TypeMember *mFirst;
 		CB_TypeMember *mLast;
 		unsigned int mSizeOfMember;
+
+		/**
+		 * @brief mFreeList is a list of deleted members linked with mBefore.
+		 */
+		CB_TypeMember *mFreeList;
+		char *mChunkPosition;
+		char *mChunkEnd;
+
+		bool mContiguous;
+		CB_TypeMemberChunk *mCurrentChunk;
+		/**
+		 * @brief mEmptyChunks is a list of the contiguous storage chunks without members.
+		 */
+		CB_TypeMemberChunk *mEmptyChunks;
+
+		/**
+		 * @brief mHandles is created when the first handle is requested.
+		 */
+		CB_TypeHandleTable *mHandles;
 };
 
 typedef CB_Type Type;
@@ -0,0 +1,274 @@
+#include "utfconversion.h"
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define UTFCONVERSION_SIMD
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+	#define UTFCONVERSION_SIMD
+#endif
+
+namespace {
+
+#ifdef UTFCONVERSION_SIMD
+#if defined(__AVX2__)
+const size_t lanes = 32;
+
+// One bit for every byte which isn't ASCII
+inline uint32_t nonAsciiMask(const uint8_t *p) {
+	return (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+}
+
+inline void asciiToUtf32(const uint8_t *from, char32_t *to) {
+	for (int i = 0; i < 4; ++i) {
+		__m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(from + i * 8)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(to + i * 8), v);
+	}
+}
+
+// Converts the characters, if all of them are ASCII
+inline bool utf32ToAscii(const char32_t *from, uint8_t *to) {
+	__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from));
+	__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + 8));
+	__m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + 16));
+	__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + 24));
+	__m256i all = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+	if (!_mm256_testz_si256(all, _mm256_set1_epi32(~0x7F))) return false;
+	// Packing works inside 128-bit lanes, so the 4 byte groups have to be reordered afterwards
+	__m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+	packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(to), packed);
+	return true;
+}
+
+inline void copyAscii(const uint8_t *from, uint8_t *to) {
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(to), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from)));
+}
+#else
+const size_t lanes = 16;
+
+// One bit for every byte which isn't ASCII
+inline uint32_t nonAsciiMask(const uint8_t *p) {
+	return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+inline void asciiToUtf32(const uint8_t *from, char32_t *to) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+	__m128i low = _mm_unpacklo_epi8(v, zero);
+	__m128i high = _mm_unpackhi_epi8(v, zero);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(to), _mm_unpacklo_epi16(low, zero));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(to + 4), _mm_unpackhi_epi16(low, zero));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(to + 8), _mm_unpacklo_epi16(high, zero));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(to + 12), _mm_unpackhi_epi16(high, zero));
+}
+
+// Converts the characters, if all of them are ASCII
+inline bool utf32ToAscii(const char32_t *from, uint8_t *to) {
+	__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+	__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + 4));
+	__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + 8));
+	__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + 12));
+	__m128i all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+	__m128i high = _mm_and_si128(all, _mm_set1_epi32(~0x7F));
+	if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xFFFF) return false;
+	__m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(to), packed);
+	return true;
+}
+
+inline void copyAscii(const uint8_t *from, uint8_t *to) {
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(to), _mm_loadu_si128(reinterpret_cast<const __m128i*>(from)));
+}
+#endif
+#endif
+
+const char trailingBytesForUTF8[256] = {
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2, 3,3,3,3,3,3,3,3,4,4,4,4,5,5,5,5
+};
+
+const char32_t offsetsFromUTF8[6] = { 0x00000000UL, 0x00003080UL, 0x000E2080UL,
+			 0x03C82080UL, 0xFA082080UL, 0x82082080UL };
+
+bool isLegalUTF8(const uint8_t *source, int length) {
+	uint8_t a;
+	const uint8_t *srcptr = source+length;
+	switch (length) {
+		default: return false;
+		/* Everything else falls through when "true"... */
+		case 4: if ((a = (*--srcptr)) < 0x80 || a > 0xBF) return false;
+		case 3: if ((a = (*--srcptr)) < 0x80 || a > 0xBF) return false;
+		case 2: if ((a = (*--srcptr)) > 0xBF) return false;
+
+		switch (*source) {
+			/* no fall-through in this inner switch */
+			case 0xE0: if (a < 0xA0) return false; break;
+			case 0xED: if (a < 0x80 || a > 0x9F) return false; break;
+			case 0xF0: if (a < 0x90) return false; break;
+			case 0xF4: if (a < 0x80 || a > 0x8F) return false; break;
+			default:   if (a < 0x80) return false;
+		}
+
+		case 1: if (*source >= 0x80 && *source < 0xC2) return false;
+	}
+	if (*source > 0xF4) return false;
+	return true;
+}
+
+/**
+ * Decodes one character. Overlong sequences, surrogates and code points over 0x10FFFF are
+ * rejected by isLegalUTF8.
+ */
+inline bool decodeUtf8(const uint8_t *&from, const uint8_t *fromEnd, char32_t &ch) {
+	int extraBytesToRead = trailingBytesForUTF8[*from];
+	if (from + extraBytesToRead >= fromEnd) return false;
+	if (!isLegalUTF8(from, extraBytesToRead + 1)) return false;
+	ch = 0;
+	switch (extraBytesToRead) {
+		case 3: ch += *from++; ch <<= 6;
+		case 2: ch += *from++; ch <<= 6;
+		case 1: ch += *from++; ch <<= 6;
+		case 0: ch += *from++;
+	}
+	ch -= offsetsFromUTF8[extraBytesToRead];
+	return true;
+}
+
+inline bool encodeUtf8(char32_t wc, uint8_t *&to, uint8_t *toEnd) {
+	if ((wc & 0xFFFFF800) == 0x00D800 || wc > 0x10FFFF)
+		return false;
+	if (wc < 0x000080) {
+		if (toEnd - to < 1)
+			return false;
+		*to++ = static_cast<uint8_t>(wc);
+	}
+	else if (wc < 0x000800) {
+		if (toEnd - to < 2)
+			return false;
+		*to++ = static_cast<uint8_t>(0xC0 | (wc >> 6));
+		*to++ = static_cast<uint8_t>(0x80 | (wc & 0x03F));
+	}
+	else if (wc < 0x010000) {
+		if (toEnd - to < 3)
+			return false;
+		*to++ = static_cast<uint8_t>(0xE0 |  (wc >> 12));
+		*to++ = static_cast<uint8_t>(0x80 | ((wc & 0x0FC0) >> 6));
+		*to++ = static_cast<uint8_t>(0x80 |  (wc & 0x003F));
+	}
+	else {
+		if (toEnd - to < 4)
+			return false;
+		*to++ = static_cast<uint8_t>(0xF0 |  (wc >> 18));
+		*to++ = static_cast<uint8_t>(0x80 | ((wc & 0x03F000) >> 12));
+		*to++ = static_cast<uint8_t>(0x80 | ((wc & 0x000FC0) >> 6));
+		*to++ = static_cast<uint8_t>(0x80 |  (wc & 0x00003F));
+	}
+	return true;
+}
+
+}
+
+size_t utfconversion::asciiPrefixLength(const uint8_t *str, size_t len) {
+	size_t i = 0;
+#ifdef UTFCONVERSION_SIMD
+	for (; i + lanes <= len; i += lanes) {
+		uint32_t mask = nonAsciiMask(str + i);
+		if (mask) return i + __builtin_ctz(mask);
+	}
+#endif
+	while (i < len && str[i] < 0x80) {
+		++i;
+	}
+	return i;
+}
+
+bool utfconversion::latin1ToUtf8(const uint8_t *from, const uint8_t *fromEnd, uint8_t *to, uint8_t *toEnd, uint8_t *&toNext) {
+	toNext = to;
+	while (from < fromEnd) {
+		const uint8_t *scalarEnd = fromEnd;
+#ifdef UTFCONVERSION_SIMD
+		if (fromEnd - from >= (ptrdiff_t)lanes && toEnd - toNext >= (ptrdiff_t)lanes) {
+			if (nonAsciiMask(from) == 0) {
+				copyAscii(from, toNext);
+				from += lanes;
+				toNext += lanes;
+				continue;
+			}
+			scalarEnd = from + lanes;
+		}
+#endif
+		for (; from < scalarEnd; ++from) {
+			uint8_t c = *from;
+			if (c < 0x80) {
+				if (toEnd - toNext < 1)
+					return false;
+				*toNext++ = c;
+			}
+			else {
+				if (toEnd - toNext < 2)
+					return false;
+				*toNext++ = static_cast<uint8_t>(0xC0 | (c >> 6));
+				*toNext++ = static_cast<uint8_t>(0x80 | (c & 0x3F));
+			}
+		}
+	}
+	return true;
+}
+
+bool utfconversion::utf32ToUtf8(const char32_t *from, const char32_t *fromEnd, const char32_t *&fromNext, uint8_t *to, uint8_t *toEnd, uint8_t *&toNext) {
+	fromNext = from;
+	toNext = to;
+	while (fromNext < fromEnd) {
+		const char32_t *scalarEnd = fromEnd;
+#ifdef UTFCONVERSION_SIMD
+		if (fromEnd - fromNext >= (ptrdiff_t)lanes && toEnd - toNext >= (ptrdiff_t)lanes) {
+			if (utf32ToAscii(fromNext, toNext)) {
+				fromNext += lanes;
+				toNext += lanes;
+				continue;
+			}
+			scalarEnd = fromNext + lanes;
+		}
+#endif
+		for (; fromNext < scalarEnd; ++fromNext) {
+			if (!encodeUtf8(*fromNext, toNext, toEnd)) return false;
+		}
+	}
+	return true;
+}
+
+bool utfconversion::utf8ToUtf32(const uint8_t *from, const uint8_t *fromEnd, const uint8_t *&fromNext, char32_t *to, char32_t *toEnd, char32_t *&toNext) {
+	fromNext = from;
+	toNext = to;
+	while (fromNext < fromEnd) {
+#ifdef UTFCONVERSION_SIMD
+		if (fromEnd - fromNext >= (ptrdiff_t)lanes && toEnd - toNext >= (ptrdiff_t)lanes) {
+			uint32_t mask = nonAsciiMask(fromNext);
+			if (mask == 0) {
+				asciiToUtf32(fromNext, toNext);
+				fromNext += lanes;
+				toNext += lanes;
+				continue;
+			}
+			// Copy the ASCII before the first multibyte sequence
+			for (int i = __builtin_ctz(mask); i > 0; --i) {
+				*toNext++ = *fromNext++;
+			}
+		}
+#endif
+		if (toNext >= toEnd) return false;
+		if (*fromNext < 0x80) {
+			*toNext++ = *fromNext++;
+			continue;
+		}
+		if (!decodeUtf8(fromNext, fromEnd, *toNext)) return false;
+		++toNext;
+	}
+	return true;
+}
@@ -0,0 +1,24 @@
+#ifndef UTFCONVERSION_H
+#define UTFCONVERSION_H
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Conversions between UTF-8 and the Latin-1 and UTF-32 strings of LString. Runs of ASCII are
+ * converted a whole SSE2 (or AVX2, if the runtime is compiled with it) register at a time and
+ * other characters one by one with full validation.
+ * The conversions stop and return false, if the output doesn't fit or the input is invalid.
+ * The next positions are set to where the conversion stopped.
+ */
+namespace utfconversion {
+	/**
+	 * @return The number of bytes before the first non-ASCII byte.
+	 */
+	size_t asciiPrefixLength(const uint8_t *str, size_t len);
+
+	bool latin1ToUtf8(const uint8_t *from, const uint8_t *fromEnd, uint8_t *to, uint8_t *toEnd, uint8_t *&toNext);
+	bool utf32ToUtf8(const char32_t *from, const char32_t *fromEnd, const char32_t *&fromNext, uint8_t *to, uint8_t *toEnd, uint8_t *&toNext);
+	bool utf8ToUtf32(const uint8_t *from, const uint8_t *fromEnd, const uint8_t *&fromNext, char32_t *to, char32_t *toEnd, char32_t *&toNext);
+}
+
+#endif // UTFCONVERSION_H